@@ -0,0 +1,661 @@
+/*******************************************************************************
+ * src/parallel/bingmann-external_sort.hpp
+ *
+ * External memory string sorting for inputs larger than RAM: runs are sorted
+ * with pS5, written to disk front-coded with their LCP arrays, and merged with
+ * the LCP aware multiway loser tree, reading the runs with asynchronous
+ * prefetching.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PARALLEL_BINGMANN_EXTERNAL_SORT_HEADER
+#define PSS_SRC_PARALLEL_BINGMANN_EXTERNAL_SORT_HEADER
+
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bingmann-parallel_sample_sort.hpp"
+#include "../sequential/bingmann-lcp_losertree.hpp"
+#include "../tools/stringset.hpp"
+#include "../tools/timer.hpp"
+#include "../tools/globals.hpp"
+
+namespace bingmann_external_sort {
+
+using namespace stringtools;
+
+static const bool debug = false;
+
+//! maximum fan-in of one merge pass, limited by LcpCacheStringLoserTree::replay
+static const size_t max_fanin = 256;
+
+/******************************************************************************/
+// Run file format
+
+/*
+ * A run file is a sequence of front-coded records, one per string in sorted
+ * order: varint(lcp) varint(suffix length) suffix characters, where lcp is
+ * the LCP with the preceding string of the run (zero for the first). The
+ * suffix excludes the terminating zero.
+ */
+
+//! write fully to fd, returns false on error
+static inline bool write_full(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t wb = ::write(fd, data, size);
+        if (wb < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += wb, size -= wb;
+    }
+    return true;
+}
+
+//! read up to size bytes from fd, returns bytes read or -1 on error
+static inline ssize_t read_full(int fd, char* data, size_t size)
+{
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t rb = ::read(fd, data + total, size - total);
+        if (rb < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (rb == 0) break;
+        total += rb;
+    }
+    return total;
+}
+
+//! Buffered writer of sorted strings, either front-coded into a run file or
+//! as plain newline terminated lines for the final output.
+class RunWriter
+{
+protected:
+    int m_fd;
+    bool m_plain;
+    std::vector<char> m_buffer;
+    size_t m_fill;
+    bool m_ok;
+
+    //! append characters to the buffer, flush if full
+    void append(const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            if (m_fill == m_buffer.size()) flush();
+
+            size_t n = std::min(size, m_buffer.size() - m_fill);
+            memcpy(m_buffer.data() + m_fill, data, n);
+            m_fill += n, data += n, size -= n;
+        }
+    }
+
+    //! append LEB128 varint
+    void append_varint(size_t v)
+    {
+        char buf[10];
+        size_t n = 0;
+        while (v >= 0x80) {
+            buf[n++] = (char)(v | 0x80);
+            v >>= 7;
+        }
+        buf[n++] = (char)v;
+        append(buf, n);
+    }
+
+public:
+    RunWriter(int fd, size_t block_size, bool plain)
+        : m_fd(fd), m_plain(plain), m_buffer(block_size), m_fill(0), m_ok(true)
+    { }
+
+    ~RunWriter()
+    {
+        flush();
+    }
+
+    //! write string s, which has lcp characters in common with the previous
+    void put(string s, lcp_t lcp)
+    {
+        if (m_plain) {
+            append((const char*)s, strlen((const char*)s));
+            append("\n", 1);
+            return;
+        }
+
+        size_t suffix = strlen((const char*)s + lcp);
+        append_varint(lcp);
+        append_varint(suffix);
+        append((const char*)s + lcp, suffix);
+    }
+
+    //! write buffered data
+    void flush()
+    {
+        if (m_fill && !write_full(m_fd, m_buffer.data(), m_fill)) m_ok = false;
+        m_fill = 0;
+    }
+
+    bool ok() const { return m_ok; }
+};
+
+//! Reader of a run file, which decodes batches of strings with their LCPs and
+//! cached characters, while the next block of the file is read
+//! asynchronously.
+class RunReader
+{
+protected:
+    int m_fd;
+    size_t m_block_size;
+
+    //! undecoded bytes [m_pos, m_buffer.size())
+    std::vector<char> m_buffer;
+    size_t m_pos;
+
+    //! block being prefetched and its pending read
+    std::vector<char> m_next;
+    std::future<ssize_t> m_prefetch;
+    bool m_eof;
+
+    //! current decoded batch
+    std::vector<char_type> m_arena;
+    std::vector<string> m_strings;
+    std::vector<lcp_t> m_lcps;
+    std::vector<char_type> m_cached;
+
+    //! last string of previous batch, needed to restore front-coded prefixes
+    std::vector<char_type> m_last;
+
+    void start_prefetch()
+    {
+        int fd = m_fd;
+        char* data = m_next.data();
+        size_t size = m_next.size();
+
+        m_prefetch = std::async(
+            std::launch::async,
+            [fd, data, size]() { return read_full(fd, data, size); });
+    }
+
+    //! append prefetched block to the buffer and start reading the next
+    bool refill()
+    {
+        if (m_eof) return false;
+
+        ssize_t rb = m_prefetch.get();
+        if (rb < 0) {
+            std::cout << "Error reading run file: " << strerror(errno) << std::endl;
+            m_eof = true;
+            return false;
+        }
+        if ((size_t)rb < m_next.size()) m_eof = true;
+
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_pos);
+        m_pos = 0;
+        m_buffer.insert(m_buffer.end(), m_next.begin(), m_next.begin() + rb);
+
+        if (!m_eof) start_prefetch();
+        return rb > 0;
+    }
+
+    //! decode varint at p, returns false if incomplete
+    static bool get_varint(const char*& p, const char* end, size_t& v)
+    {
+        v = 0;
+        for (unsigned shift = 0; p < end; shift += 7)
+        {
+            unsigned char c = *p++;
+            v |= (size_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    //! decode all complete records in the buffer into the batch
+    size_t decode()
+    {
+        const char* begin = m_buffer.data() + m_pos;
+        const char* end = m_buffer.data() + m_buffer.size();
+
+        // first pass: count complete records and their decoded size
+        size_t count = 0, chars = 0;
+        const char* p = begin, * rec_end = begin;
+        while (p < end)
+        {
+            size_t lcp, suffix;
+            if (!get_varint(p, end, lcp) || !get_varint(p, end, suffix))
+                break;
+            if ((size_t)(end - p) < suffix) break;
+            p += suffix;
+
+            rec_end = p;
+            ++count, chars += lcp + suffix + 1;
+        }
+
+        m_arena.resize(chars);
+        m_strings.resize(count);
+        m_lcps.resize(count);
+        m_cached.resize(count);
+
+        // second pass: restore full strings from the previous one
+        const char_type* prev = m_last.data();
+        char_type* out = m_arena.data();
+        p = begin;
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t lcp, suffix;
+            get_varint(p, end, lcp);
+            get_varint(p, end, suffix);
+
+            memcpy(out, prev, lcp);
+            memcpy(out + lcp, p, suffix);
+            out[lcp + suffix] = 0;
+            p += suffix;
+
+            m_strings[i] = out;
+            m_lcps[i] = lcp;
+            m_cached[i] = out[lcp];
+
+            prev = out;
+            out += lcp + suffix + 1;
+        }
+
+        if (count) {
+            size_t len = out - prev;
+            m_last.assign(prev, prev + len);
+        }
+
+        m_pos += rec_end - begin;
+        return count;
+    }
+
+public:
+    RunReader(int fd, size_t block_size)
+        : m_fd(fd), m_block_size(block_size), m_pos(0),
+          m_next(block_size), m_eof(false), m_last(1, 0)
+    {
+        start_prefetch();
+    }
+
+    ~RunReader()
+    {
+        if (m_prefetch.valid()) m_prefetch.wait();
+    }
+
+    //! decode the next batch of strings, returns an empty stream at the end of
+    //! the run. The previous batch is invalidated.
+    LcpCacheStringPtr next_batch()
+    {
+        size_t count = 0;
+        while ((count = decode()) == 0)
+        {
+            if (!refill()) break;
+        }
+
+        if (count == 0 && m_pos != m_buffer.size())
+            std::cout << "Error: truncated record at end of run file" << std::endl;
+
+        return LcpCacheStringPtr(
+            m_strings.data(), m_lcps.data(), m_cached.data(), count);
+    }
+};
+
+/******************************************************************************/
+// Multiway merging of runs
+
+/*!
+ * LCP aware loser tree over RunReaders: a stream whose current batch is
+ * exhausted is refilled with the next batch of its run. The LCP of the first
+ * string of a batch is relative to the last string of the previous batch,
+ * which has just been output, hence the tree's invariants still hold, and
+ * characters already compared are skipped.
+ */
+template <size_t K>
+class RunLoserTree : public bingmann::LcpCacheStringLoserTree<K>
+{
+    typedef bingmann::LcpCacheStringLoserTree<K> super_type;
+    typedef LcpCacheStringPtr Stream;
+
+public:
+    RunLoserTree(RunReader** readers, size_t numReaders)
+    {
+        assert(numReaders <= K);
+
+        for (size_t i = 0; i < K; ++i)
+            this->streams[i] = i < numReaders ? readers[i]->next_batch() : Stream();
+
+        this->initTree(0);
+    }
+
+    //! merge all runs into output, returns number of strings
+    size_t merge(RunReader** readers, RunWriter& output)
+    {
+        size_t count = 0;
+        size_t contenderIdx = this->nodes[0];
+
+        while (!this->streams[contenderIdx].empty())
+        {
+            Stream& stream = this->streams[contenderIdx];
+
+            output.put(stream.firstString(), this->lcps[contenderIdx]);
+            ++count;
+
+            ++stream;
+            if (stream.empty())
+                stream = readers[contenderIdx]->next_batch();
+
+            if (!stream.empty())
+            {
+                this->lcps[contenderIdx] = stream.firstLcp();
+                this->cached[contenderIdx] = stream.firstCached();
+            }
+
+            this->replay(contenderIdx);
+        }
+
+        this->nodes[0] = contenderIdx;
+        return count;
+    }
+};
+
+//! merge up to K runs with a loser tree of the smallest sufficient size
+static inline size_t
+merge_runs(RunReader** readers, size_t k, RunWriter& output)
+{
+    if (k <= 2) return RunLoserTree<2>(readers, k).merge(readers, output);
+    if (k <= 4) return RunLoserTree<4>(readers, k).merge(readers, output);
+    if (k <= 8) return RunLoserTree<8>(readers, k).merge(readers, output);
+    if (k <= 16) return RunLoserTree<16>(readers, k).merge(readers, output);
+    if (k <= 32) return RunLoserTree<32>(readers, k).merge(readers, output);
+    if (k <= 64) return RunLoserTree<64>(readers, k).merge(readers, output);
+    if (k <= 128) return RunLoserTree<128>(readers, k).merge(readers, output);
+    return RunLoserTree<256>(readers, k).merge(readers, output);
+}
+
+/******************************************************************************/
+// External Sort Driver
+
+//! External sorter of a file of newline terminated lines
+class ExternalSorter
+{
+protected:
+    //! maximum bytes of input characters sorted in memory per run
+    size_t m_run_size;
+
+    //! size of I/O blocks per run during merging
+    size_t m_block_size;
+
+    //! directory for temporary run files
+    std::string m_tmpdir;
+
+    //! names of run files not yet merged
+    std::vector<std::string> m_runs;
+
+    //! counter for unique run file names
+    size_t m_run_counter;
+
+    std::string new_run_name()
+    {
+        std::ostringstream oss;
+        oss << m_tmpdir << "/pss-run-" << getpid() << "-" << m_run_counter++;
+        return oss.str();
+    }
+
+    //! sort chunk of n characters, which ends with a zero, with pS5 and
+    //! write it as a run.
+    bool sort_run(char_type* chars, size_t n)
+    {
+        // collect string starts
+        std::vector<string> strings;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (i == 0 || chars[i - 1] == 0)
+                strings.push_back(chars + i);
+        }
+
+        std::vector<lcp_t> lcp(strings.size());
+
+        bingmann_parallel_sample_sort::parallel_sample_sort_lcp_base<
+            bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX>(
+            parallel_string_sorting::UCharStringSet(
+                strings.data(), strings.data() + strings.size()),
+            lcp.data(), 0);
+        lcp[0] = 0;
+
+        // drop statistics of the pS5 run, sort_file() outputs its own
+        g_stats.clear();
+
+        std::string name = new_run_name();
+        int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            std::cout << "Cannot create run file " << name << ": "
+                      << strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool ok;
+        {
+            RunWriter writer(fd, m_block_size, false);
+            for (size_t i = 0; i < strings.size(); ++i)
+                writer.put(strings[i], lcp[i]);
+            writer.flush();
+            ok = writer.ok();
+        }
+        close(fd);
+
+        if (!ok) {
+            std::cout << "Error writing run file " << name << ": "
+                      << strerror(errno) << std::endl;
+            return false;
+        }
+
+        LOG << "Run " << name << " with " << strings.size() << " strings";
+
+        m_runs.push_back(name);
+        return true;
+    }
+
+    //! merge runs into fd, either as a new run or as plain lines, and remove
+    //! the run files.
+    bool merge(const std::vector<std::string>& runs, int fd, bool plain)
+    {
+        std::vector<int> fds;
+        std::vector<RunReader*> readers;
+
+        bool ok = true;
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            int rfd = open(runs[i].c_str(), O_RDONLY);
+            if (rfd < 0) {
+                std::cout << "Cannot open run file " << runs[i] << ": "
+                          << strerror(errno) << std::endl;
+                ok = false;
+                break;
+            }
+            posix_fadvise(rfd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            fds.push_back(rfd);
+            readers.push_back(new RunReader(rfd, m_block_size));
+        }
+
+        if (ok)
+        {
+            RunWriter writer(fd, m_block_size, plain);
+            merge_runs(readers.data(), readers.size(), writer);
+            writer.flush();
+            ok = writer.ok();
+        }
+
+        for (size_t i = 0; i < readers.size(); ++i) {
+            delete readers[i];
+            close(fds[i]);
+        }
+        for (size_t i = 0; i < runs.size(); ++i)
+            unlink(runs[i].c_str());
+
+        return ok;
+    }
+
+public:
+    ExternalSorter(size_t run_size, size_t block_size, const std::string& tmpdir)
+        : m_run_size(run_size), m_block_size(block_size), m_tmpdir(tmpdir),
+          m_run_counter(0)
+    { }
+
+    //! sort the lines of file input and write them to file output
+    bool sort_file(const std::string& input, const std::string& output)
+    {
+        int fd = open(input.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << "Cannot open " << input << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        ClockTimer timer;
+        size_t char_count = 0, run_count = 0;
+
+        // form sorted runs: read chunks of run_size, cut at the last newline
+        // and carry the remainder to the next chunk.
+        std::vector<char_type> chunk(m_run_size + 1);
+        size_t fill = 0;
+        bool eof = false;
+
+        while (!eof)
+        {
+            ssize_t rb = read_full(fd, (char*)chunk.data() + fill, m_run_size - fill);
+            if (rb < 0) {
+                std::cout << "Cannot read from " << input << ": "
+                          << strerror(errno) << std::endl;
+                close(fd);
+                return false;
+            }
+            if (fill + rb < m_run_size) eof = true;
+
+            fill += rb;
+            char_count += rb;
+            if (fill == 0) break;
+
+            size_t cut = fill;
+            if (!eof) {
+                while (cut > 0 && chunk[cut - 1] != '\n') --cut;
+                if (cut == 0) {
+                    std::cout << "Line longer than run size in " << input << std::endl;
+                    close(fd);
+                    return false;
+                }
+            }
+            else if (chunk[cut - 1] != '\n') {
+                // terminate unterminated last line
+                chunk[cut++] = '\n';
+                fill = cut;
+            }
+
+            for (size_t i = 0; i < cut; ++i) {
+                if (chunk[i] == '\n') chunk[i] = 0;
+            }
+
+            if (!sort_run(chunk.data(), cut)) {
+                close(fd);
+                return false;
+            }
+            ++run_count;
+
+            // carry incomplete last line to next chunk
+            memmove(chunk.data(), chunk.data() + cut, fill - cut);
+            fill -= cut;
+        }
+        close(fd);
+
+        double time_runs = timer.elapsed();
+
+        // merge passes with at most max_fanin runs each
+        while (m_runs.size() > max_fanin)
+        {
+            std::vector<std::string> runs;
+            runs.swap(m_runs);
+
+            for (size_t begin = 0; begin < runs.size(); begin += max_fanin)
+            {
+                size_t end = std::min(begin + max_fanin, runs.size());
+                std::string name = new_run_name();
+
+                int ofd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+                if (ofd < 0) {
+                    std::cout << "Cannot create run file " << name << ": "
+                              << strerror(errno) << std::endl;
+                    return false;
+                }
+
+                bool ok = merge(
+                    std::vector<std::string>(
+                        runs.begin() + begin, runs.begin() + end), ofd, false);
+                close(ofd);
+
+                if (!ok) return false;
+                m_runs.push_back(name);
+            }
+        }
+
+        // final merge into output file
+        int ofd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (ofd < 0) {
+            std::cout << "Cannot create " << output << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool ok = merge(m_runs, ofd, true);
+        m_runs.clear();
+        close(ofd);
+
+        if (!ok) {
+            std::cout << "Error writing " << output << std::endl;
+            return false;
+        }
+
+        double time_total = timer.elapsed();
+
+        g_stats >> "run_size" << m_run_size
+            >> "block_size" << m_block_size
+            >> "run_count" << run_count
+            >> "char_count" << char_count
+            >> "time_runs" << time_runs
+            >> "time_merge" << time_total - time_runs
+            >> "time" << time_total;
+
+        return true;
+    }
+};
+
+} // namespace bingmann_external_sort
+
+#endif // !PSS_SRC_PARALLEL_BINGMANN_EXTERNAL_SORT_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_auto.cpp
+ *
+ * Adaptive selection of a parallel string sorter, see
+ * bingmann-parallel_auto.hpp.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "bingmann-parallel_auto.hpp"
+
+namespace bingmann_parallel_auto {
+
+static inline void parallel_auto(unsigned char** strings, size_t n)
+{
+    return parallel_auto_generic(
+        parallel_string_sorting::UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_auto,
+                        "bingmann/parallel_auto",
+                        "Select radix sort, MKQS or pS5 by sampling the input")
+
+} // namespace bingmann_parallel_auto
+
+/******************************************************************************/
@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_auto.hpp
+ *
+ * Adaptive selection of a parallel string sorter: sample the input, estimate
+ * alphabet size, distinguishing prefix and duplicate rate, and dispatch to
+ * parallel radix sort, parallel multikey quicksort or pS5.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PARALLEL_BINGMANN_PARALLEL_AUTO_HEADER
+#define PSS_SRC_PARALLEL_BINGMANN_PARALLEL_AUTO_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <omp.h>
+
+#include "bingmann-parallel_mkqs.hpp"
+#include "bingmann-parallel_radix_sort.hpp"
+#include "bingmann-parallel_sample_sort.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/lcgrandom.hpp"
+
+namespace bingmann_parallel_auto {
+
+//! number of strings sampled to profile the input
+static const size_t sample_size = 4096;
+
+//! characters of a sampled string scanned for the alphabet and length
+static const size_t scan_length = 256;
+
+//! at most this many distinct characters select radix sort
+static const size_t radix_max_alphabet = 16;
+
+//! at most this estimated distinguishing prefix selects multikey quicksort
+static const double mkqs_max_dprefix = 16.0;
+
+//! at least this duplicate rate selects pS5, whose equal buckets end at
+//! terminated keys
+static const double ps5_min_duplicates = 0.3;
+
+//! minimum number of strings per thread
+static const size_t strings_per_thread = 64 * 1024;
+
+//! parallel sorters the selector dispatches to
+enum engine_type { ENGINE_RADIX_8BIT, ENGINE_MKQS, ENGINE_PS5 };
+
+static inline const char * engine_name(engine_type e)
+{
+    return e == ENGINE_RADIX_8BIT ? "parallel_radix_sort_8bit" :
+           e == ENGINE_MKQS ? "parallel_mkqs" : "parallel_sample_sort";
+}
+
+//! properties of the input estimated from a sample
+struct InputProfile
+{
+    //! number of sampled strings
+    size_t sample;
+    //! number of distinct characters in the sampled strings
+    size_t alphabet;
+    //! average length of the sampled strings, scanned up to scan_length
+    double avg_length;
+    //! estimated average distinguishing prefix of the whole input
+    double dprefix;
+    //! fraction of sampled strings equal to another sampled string
+    double duplicates;
+};
+
+/*!
+ * Profile the strings of ss beyond depth from a random sample. The sample is
+ * sorted, its LCPs give the distinguishing prefix and duplicates of the sample.
+ * As the whole input is n/sample times denser, the distinguishing prefix is
+ * raised by log_alphabet(n/sample), which is exact for random strings.
+ */
+template <typename StringSet>
+InputProfile estimate_profile(const StringSet& ss, size_t depth)
+{
+    typedef typename StringSet::String String;
+    typedef typename StringSet::CharIterator CharIterator;
+
+    size_t n = ss.size();
+    InputProfile p;
+    p.sample = std::min(n, sample_size);
+
+    // select one random string from each of sample equal ranges, which
+    // never samples a string twice. Scan for alphabet and length.
+    std::vector<size_t> idx(p.sample);
+    bool seen[256] = { false };
+    size_t length = 0;
+
+    LCGRandom rng(n);
+    for (size_t i = 0; i < p.sample; ++i)
+    {
+        size_t begin = n * i / p.sample, end = n * (i + 1) / p.sample;
+        idx[i] = begin + rng() % (end - begin);
+
+        const String& s = ss.at(idx[i]);
+        CharIterator c = ss.get_chars(s, depth);
+        for (size_t d = 0; d < scan_length && !ss.is_end(s, c); ++d, ++c) {
+            seen[static_cast<unsigned char>(*c)] = true;
+            ++length;
+        }
+    }
+
+    p.alphabet = std::count(seen, seen + 256, true);
+    p.avg_length = p.sample ? static_cast<double>(length) / p.sample : 0;
+
+    // sort sample and calculate LCPs of neighbours
+    std::sort(idx.begin(), idx.end(),
+              [&ss, depth](size_t a, size_t b) {
+                  return ss.is_less_at(ss.at(a), ss.at(b), depth);
+              });
+
+    std::vector<size_t> lcp(p.sample + 1, 0);
+    size_t dups = 0;
+    for (size_t i = 1; i < p.sample; ++i)
+    {
+        const String& a = ss.at(idx[i - 1]);
+        const String& b = ss.at(idx[i]);
+        CharIterator ai = ss.get_chars(a, depth), bi = ss.get_chars(b, depth);
+
+        size_t h = 0;
+        while (h < scan_length && ss.is_equal(a, ai, b, bi))
+            ++ai, ++bi, ++h;
+        lcp[i] = h;
+
+        if (h < scan_length && ss.is_end(a, ai) && ss.is_end(b, bi))
+            ++dups;
+    }
+
+    // distinguishing prefix of each sampled string
+    double dsum = 0;
+    for (size_t i = 0; i < p.sample; ++i)
+        dsum += std::max(lcp[i], lcp[i + 1]) + 1;
+
+    p.dprefix = p.sample ? dsum / p.sample : 0;
+    if (p.sample < n) {
+        p.dprefix += std::log(static_cast<double>(n) / p.sample)
+                     / std::log(static_cast<double>(std::max<size_t>(2, p.alphabet)));
+    }
+    p.dprefix = std::min(p.dprefix, p.avg_length + 1);
+
+    p.duplicates = p.sample ? static_cast<double>(dups) / p.sample : 0;
+
+    return p;
+}
+
+//! select parallel sorter for the profile
+static inline engine_type select_engine(const InputProfile& p)
+{
+    if (p.duplicates >= ps5_min_duplicates)
+        return ENGINE_PS5;
+    if (p.alphabet <= radix_max_alphabet)
+        return ENGINE_RADIX_8BIT;
+    if (p.dprefix <= mkqs_max_dprefix)
+        return ENGINE_MKQS;
+    return ENGINE_PS5;
+}
+
+//! select number of threads for n strings, at most the current maximum
+static inline size_t select_threads(size_t n)
+{
+    size_t threads = std::max<size_t>(1, n / strings_per_thread);
+    return std::min<size_t>(threads, omp_get_max_threads());
+}
+
+/*!
+ * Sort ss with the parallel sorter and thread count selected by profiling a
+ * sample of the input. The profile and decision are logged in g_stats.
+ */
+template <typename StringSet>
+void parallel_auto_generic(const StringSet& ss, size_t depth)
+{
+    InputProfile p = estimate_profile(ss, depth);
+    engine_type engine = select_engine(p);
+    size_t threads = select_threads(ss.size());
+
+    g_stats >> "auto_sample" << p.sample
+        >> "auto_alphabet" << p.alphabet
+        >> "auto_avg_length" << p.avg_length
+        >> "auto_dprefix" << p.dprefix
+        >> "auto_duplicates" << p.duplicates
+        >> "auto_algo" << engine_name(engine)
+        >> "auto_threads" << threads;
+
+    int prev_threads = omp_get_max_threads();
+    omp_set_num_threads(threads);
+
+    if (engine == ENGINE_RADIX_8BIT)
+        bingmann_parallel_radix_sort::parallel_radix_sort_8bit_generic(ss, depth);
+    else if (engine == ENGINE_MKQS)
+        bingmann_parallel_mkqs::bingmann_parallel_mkqs(ss, depth);
+    else
+        bingmann_parallel_sample_sort::parallel_sample_sort_base(ss, depth);
+
+    omp_set_num_threads(prev_threads);
+}
+
+} // namespace bingmann_parallel_auto
+
+#endif // !PSS_SRC_PARALLEL_BINGMANN_PARALLEL_AUTO_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_copy_burstsort.cpp
+ *
+ * Parallel copy-burstsort after Sinha's C-burstsort, see
+ * bingmann-parallel_copy_burstsort.hpp.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "bingmann-parallel_copy_burstsort.hpp"
+
+namespace bingmann_parallel_copy_burstsort {
+
+static inline void parallel_copy_burstsort(unsigned char** strings, size_t n)
+{
+    return parallel_copy_burstsort(strings, n, 0);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_copy_burstsort,
+                        "bingmann/parallel_copy_burstsort",
+                        "Parallel copy-burstsort with sharded burst tries")
+
+} // namespace bingmann_parallel_copy_burstsort
+
+/******************************************************************************/
@@ -0,0 +1,385 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_copy_burstsort.hpp
+ *
+ * Parallel copy-burstsort after Sinha's C-burstsort: the strings are sharded
+ * by their first characters in parallel, each shard is inserted by one job
+ * into its own burst trie, whose bins hold copies of the string tails, and the
+ * bins are sorted in parallel while traversing the tries.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PARALLEL_BINGMANN_PARALLEL_COPY_BURSTSORT_HEADER
+#define PSS_SRC_PARALLEL_BINGMANN_PARALLEL_COPY_BURSTSORT_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <omp.h>
+
+#include "../tools/contest.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/stringtools.hpp"
+#include "../tools/stringset.hpp"
+#include "../tools/jobqueue.hpp"
+
+#include "../sequential/bingmann-mkqs.hpp"
+
+namespace bingmann_parallel_copy_burstsort {
+
+using namespace jobqueue;
+
+typedef unsigned char* string;
+
+//! initial capacity of a bin in bytes
+static const size_t bin_initial = 512;
+
+//! bins holding more bytes are burst into a new trie node, this is
+//! C-burstsort's CACHESIZE.
+static const size_t burst_size = 512 * 1024;
+
+//! bins of at least this many bytes are sorted by a job of their own, smaller
+//! ones directly during the traversal.
+static const size_t sort_job_size = 64 * 1024;
+
+//! minimum number of strings per shard
+static const size_t shard_min_size = 4096;
+
+static size_t g_shard_threshold;    // shards larger than this are split again
+static std::atomic<size_t> g_nodes; // number of trie nodes created
+
+/******************************************************************************/
+// Burst Trie
+
+/*!
+ * Bin of a trie node: a growing array of copied string tails, each preceded by
+ * the pointer to its original string. Tails are copied unaligned, hence the
+ * record pointers are read and written with memcpy().
+ */
+struct Bin
+{
+    //! number of tails in bin
+    size_t count;
+    //! begin, end of used space, and end of allocated space
+    unsigned char* begin, * end, * limit;
+};
+
+//! trie node with a child or bin for each character. Strings ending at the
+//! node are collected in bin[0], which is never burst.
+struct Node
+{
+    Node* child[256];
+    Bin bin[256];
+};
+
+static inline Node * new_node()
+{
+    ++g_nodes;
+    return static_cast<Node*>(calloc(1, sizeof(Node)));
+}
+
+//! append the record pointer and the tail including its terminator
+static inline void bin_append(Bin& b, string record, const unsigned char* tail)
+{
+    size_t len = strlen(reinterpret_cast<const char*>(tail)) + 1;
+    size_t need = sizeof(string) + len;
+
+    if (b.end + need > b.limit)
+    {
+        size_t used = b.end - b.begin;
+        size_t cap = std::max<size_t>(bin_initial, 2 * (b.limit - b.begin));
+        while (cap < used + need) cap *= 2;
+
+        b.begin = static_cast<unsigned char*>(realloc(b.begin, cap));
+        b.end = b.begin + used;
+        b.limit = b.begin + cap;
+    }
+
+    memcpy(b.end, &record, sizeof(string));
+    memcpy(b.end + sizeof(string), tail, len);
+    b.end += need;
+    ++b.count;
+}
+
+static inline void insert(Node* node, const unsigned char* tail, string record);
+
+//! replace the bin of character c by a new node and insert its tails there
+static inline void burst(Node* node, unsigned char c)
+{
+    Bin old = node->bin[c];
+    memset(&node->bin[c], 0, sizeof(Bin));
+
+    Node* child = node->child[c] = new_node();
+
+    for (unsigned char* p = old.begin; p != old.end; )
+    {
+        string record;
+        memcpy(&record, p, sizeof(string));
+        p += sizeof(string);
+
+        insert(child, p, record);
+        p += strlen(reinterpret_cast<const char*>(p)) + 1;
+    }
+
+    free(old.begin);
+}
+
+//! insert tail of the string record below node, bursting a full bin
+static inline void insert(Node* node, const unsigned char* tail, string record)
+{
+    while (*tail && node->child[*tail])
+        node = node->child[*tail++];
+
+    unsigned char c = *tail;
+    Bin& b = node->bin[c];
+    bin_append(b, record, c ? tail + 1 : tail);
+
+    // a single long tail is not burst, it would only move one level down
+    if (c && b.count > 1 && static_cast<size_t>(b.end - b.begin) > burst_size)
+        burst(node, c);
+}
+
+//! sort the tails of a bin and write their record pointers to out, frees bin.
+static inline void sort_bin(Bin& b, string* out)
+{
+    std::vector<string> tails(b.count);
+
+    unsigned char* p = b.begin;
+    for (size_t i = 0; i < b.count; ++i) {
+        tails[i] = p + sizeof(string);
+        p = tails[i] + strlen(reinterpret_cast<const char*>(tails[i])) + 1;
+    }
+
+    bingmann::mkqs_generic(
+        parallel_string_sorting::UCharStringSet(
+            tails.data(), tails.data() + b.count), 0);
+
+    for (size_t i = 0; i < b.count; ++i)
+        memcpy(out + i, tails[i] - sizeof(string), sizeof(string));
+
+    free(b.begin);
+}
+
+/******************************************************************************/
+// Jobs
+
+struct SortBinJob final : public Job
+{
+    Bin     bin;
+    string* out;
+
+    SortBinJob(JobQueue& job_queue, const Bin& bin, string* out)
+        : bin(bin), out(out)
+    {
+        job_queue.enqueue(this);
+    }
+
+    virtual bool run(JobQueue&)
+    {
+        sort_bin(bin, out);
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "Burst SortBinJob"; }
+
+    virtual size_t trace_size() const
+    { return bin.count; }
+};
+
+/*!
+ * Insert a shard of strings, which are equal up to depth, into a new burst
+ * trie. Then traverse the trie in order, write the pointers of ended strings
+ * and sort the bins into the shard's range.
+ */
+struct BuildJob final : public Job
+{
+    string* strings;
+    size_t  n, depth;
+
+    BuildJob(JobQueue& job_queue, string* strings, size_t n, size_t depth)
+        : strings(strings), n(n), depth(depth)
+    {
+        job_queue.enqueue(this);
+    }
+
+    //! traverse node, frees it and hands out its bins
+    void traverse(JobQueue& job_queue, Node* node, string*& out)
+    {
+        for (size_t c = 0; c < 256; ++c)
+        {
+            if (node->child[c]) {
+                traverse(job_queue, node->child[c], out);
+                continue;
+            }
+
+            Bin& b = node->bin[c];
+            if (b.count == 0) continue;
+
+            if (c == 0 || b.count == 1)
+            {
+                // ended strings are equal, the single tail is sorted
+                unsigned char* p = b.begin;
+                for (size_t i = 0; i < b.count; ++i) {
+                    memcpy(out + i, p, sizeof(string));
+                    p += sizeof(string);
+                    p += strlen(reinterpret_cast<const char*>(p)) + 1;
+                }
+                free(b.begin);
+            }
+            else if (static_cast<size_t>(b.end - b.begin) < sort_job_size)
+                sort_bin(b, out);
+            else
+                new SortBinJob(job_queue, b, out);
+
+            out += b.count;
+        }
+
+        free(node);
+    }
+
+    virtual bool run(JobQueue& job_queue)
+    {
+        Node* root = new_node();
+
+        for (size_t i = 0; i < n; ++i)
+            insert(root, strings[i] + depth, strings[i]);
+
+        // strings were copied into the bins, overwrite them in order
+        string* out = strings;
+        traverse(job_queue, root, out);
+
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "Burst BuildJob"; }
+
+    virtual size_t trace_size() const
+    { return n; }
+};
+
+/******************************************************************************/
+// Shared top levels
+
+/*!
+ * Distribute strings, which are equal up to depth, by their character at depth
+ * with all threads. Shards larger than g_shard_threshold are split again at
+ * the next depth, smaller ones are inserted into a burst trie by a BuildJob.
+ * Returns number of shards.
+ */
+static inline size_t split(JobQueue& job_queue, string* strings, size_t n,
+                           size_t depth, string* tmp, unsigned char* chars)
+{
+    if (n <= g_shard_threshold) {
+        new BuildJob(job_queue, strings, n, depth);
+        return 1;
+    }
+
+    size_t bkt[256 + 1];
+    std::vector<size_t> tbkt(omp_get_max_threads() * 256);
+
+#pragma omp parallel
+    {
+        size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+        size_t begin = n * t / nthr, end = n * (t + 1) / nthr;
+
+        size_t* mybkt = tbkt.data() + t * 256;
+        std::fill(mybkt, mybkt + 256, 0);
+
+        for (size_t i = begin; i < end; ++i)
+            ++mybkt[chars[i] = strings[i][depth]];
+
+#pragma omp barrier
+#pragma omp single
+        {
+            // exclusive prefix sum in bucket-major, thread-minor order
+            size_t sum = 0;
+            for (size_t c = 0; c < 256; ++c)
+            {
+                bkt[c] = sum;
+                for (size_t p = 0; p < nthr; ++p) {
+                    size_t s = tbkt[p * 256 + c];
+                    tbkt[p * 256 + c] = sum;
+                    sum += s;
+                }
+            }
+            bkt[256] = sum;
+        }
+
+        for (size_t i = begin; i < end; ++i)
+            tmp[mybkt[chars[i]]++] = strings[i];
+
+#pragma omp barrier
+
+        memcpy(strings + begin, tmp + begin, (end - begin) * sizeof(string));
+    }
+
+    // bucket 0 contains equal strings, which are finished
+    size_t shards = 0;
+    for (size_t c = 1; c < 256; ++c)
+    {
+        size_t size = bkt[c + 1] - bkt[c];
+        if (size <= 1) continue;
+
+        shards += split(job_queue, strings + bkt[c], size, depth + 1,
+                        tmp + bkt[c], chars + bkt[c]);
+    }
+
+    return shards;
+}
+
+/******************************************************************************/
+// Frontends
+
+static inline
+void parallel_copy_burstsort(string* strings, size_t n, size_t depth)
+{
+    g_shard_threshold =
+        std::max(shard_min_size, n / omp_get_max_threads());
+    g_nodes = 0;
+
+    size_t shards;
+    JobQueue job_queue;
+    {
+        // temporary arrays of the parallel split, only for large inputs
+        std::vector<string> tmp(n > g_shard_threshold ? n : 0);
+        std::vector<unsigned char> chars(tmp.size());
+
+        shards = split(job_queue, strings, n, depth, tmp.data(), chars.data());
+    }
+    job_queue.loop();
+
+    g_stats >> "burst_shards" << shards
+        >> "burst_nodes" << g_nodes;
+}
+
+static inline
+void parallel_copy_burstsort(
+    const parallel_string_sorting::UCharStringSet& ss, size_t depth)
+{
+    parallel_copy_burstsort(ss.begin(), ss.size(), depth);
+}
+
+} // namespace bingmann_parallel_copy_burstsort
+
+#endif // !PSS_SRC_PARALLEL_BINGMANN_PARALLEL_COPY_BURSTSORT_HEADER
+
+/******************************************************************************/
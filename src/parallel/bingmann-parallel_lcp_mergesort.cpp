@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_lcp_mergesort.cpp
+ *
+ * Standalone parallel K-way LCP mergesort, see
+ * bingmann-parallel_lcp_mergesort.hpp.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "bingmann-parallel_lcp_mergesort.hpp"
+
+namespace bingmann_parallel_lcp_mergesort {
+
+static inline void parallel_lcp_mergesort_4way(string* strings, size_t n)
+{
+    parallel_lcp_mergesort<4>(strings, n, 0);
+}
+
+static inline void parallel_lcp_mergesort_8way(string* strings, size_t n)
+{
+    parallel_lcp_mergesort<8>(strings, n, 0);
+}
+
+static inline void parallel_lcp_mergesort_16way(string* strings, size_t n)
+{
+    parallel_lcp_mergesort<16>(strings, n, 0);
+}
+
+static inline void parallel_lcp_mergesort_64way(string* strings, size_t n)
+{
+    parallel_lcp_mergesort<64>(strings, n, 0);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_lcp_mergesort_4way,
+                        "bingmann/parallel_lcp_mergesort_4way",
+                        "Parallel LCP-Mergesort with 4-way runs and LCP splitting")
+PSS_CONTESTANT_PARALLEL(parallel_lcp_mergesort_8way,
+                        "bingmann/parallel_lcp_mergesort_8way",
+                        "Parallel LCP-Mergesort with 8-way runs and LCP splitting")
+PSS_CONTESTANT_PARALLEL(parallel_lcp_mergesort_16way,
+                        "bingmann/parallel_lcp_mergesort_16way",
+                        "Parallel LCP-Mergesort with 16-way runs and LCP splitting")
+PSS_CONTESTANT_PARALLEL(parallel_lcp_mergesort_64way,
+                        "bingmann/parallel_lcp_mergesort_64way",
+                        "Parallel LCP-Mergesort with 64-way runs and LCP splitting")
+
+} // namespace bingmann_parallel_lcp_mergesort
+
+/******************************************************************************/
@@ -0,0 +1,411 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_lcp_mergesort.hpp
+ *
+ * Standalone parallel K-way LCP mergesort: sorts one run per thread with the
+ * sequential LCP mergesort, then merges all runs with LCP loser trees in jobs
+ * found by splitting the runs at sampled splitters.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LCP_MERGESORT_HEADER
+#define PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LCP_MERGESORT_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include <omp.h>
+
+#include "../tools/contest.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/stringtools.hpp"
+#include "../tools/stringset.hpp"
+#include "../tools/jobqueue.hpp"
+
+#include "../sequential/bingmann-lcp_losertree.hpp"
+#include "../sequential/bingmann-lcp_mergesort_kway.hpp"
+
+namespace bingmann_parallel_lcp_mergesort {
+
+using namespace jobqueue;
+using namespace stringtools;
+
+//! due to ambiguous symbol
+using stringtools::string;
+
+//! characters compared at once when splitting the runs
+typedef uint64_t key_type;
+
+//! maximum number of runs, which is the largest loser tree
+static const size_t max_runs = 64;
+
+//! minimum number of strings per run and per merge job
+static const size_t min_job_size = 4096;
+
+/*!
+ * Variables shared by all jobs of one sort: the input, which is overwritten
+ * by the merge, and the runs with LCP and cached characters.
+ */
+struct Context
+{
+    string* strings;
+    size_t n;
+
+    //! sorted runs of the input
+    std::vector<LcpCacheStringPtr> runs;
+
+    //! merges of about this many strings are one job
+    size_t merge_size;
+
+    //! number of unfinished run jobs
+    std::atomic<size_t> pwork;
+};
+
+/******************************************************************************/
+// Merge Jobs
+
+//! K-way merge of streams, whose strings all share depth characters, into
+//! output.
+template <size_t K>
+struct MergeJob final : public Job
+{
+    bingmann::LcpCacheStringLoserTree<K> tree;
+    string* output;
+    size_t length;
+    lcp_t depth;
+
+    MergeJob(JobQueue& job_queue, const LcpCacheStringPtr* streams,
+             size_t num, string* output, size_t length, lcp_t depth)
+        : output(output), length(length), depth(depth)
+    {
+        for (size_t i = 0; i < K; ++i)
+            tree.streams[i] = i < num ? streams[i] : LcpCacheStringPtr();
+        job_queue.enqueue(this);
+    }
+
+    virtual bool run(JobQueue&)
+    {
+        tree.initTree(depth);
+        tree.writeElementsToStream(output, length);
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "LCP MergeJob"; }
+
+    virtual size_t trace_size() const
+    { return length; }
+};
+
+//! concatenation of streams of equal strings
+struct CopyJob final : public Job
+{
+    std::vector<LcpCacheStringPtr> streams;
+    string* output;
+    size_t length;
+
+    CopyJob(JobQueue& job_queue, const std::vector<LcpCacheStringPtr>& streams,
+            string* output, size_t length)
+        : streams(streams), output(output), length(length)
+    {
+        job_queue.enqueue(this);
+    }
+
+    virtual bool run(JobQueue&)
+    {
+        for (size_t i = 0; i < streams.size(); ++i) {
+            streams[i].copyStringsTo(output, streams[i].size);
+            output += streams[i].size;
+        }
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "LCP CopyJob"; }
+
+    virtual size_t trace_size() const
+    { return length; }
+};
+
+//! enqueue a merge of the non-empty streams with the smallest loser tree
+static inline void
+enqueue_merge(JobQueue& job_queue, const std::vector<LcpCacheStringPtr>& in,
+              string* output, size_t length, lcp_t depth)
+{
+    LcpCacheStringPtr streams[max_runs];
+    size_t num = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (!in[i].empty()) streams[num++] = in[i];
+    }
+
+    if (num <= 2)
+        new MergeJob<2>(job_queue, streams, num, output, length, depth);
+    else if (num <= 4)
+        new MergeJob<4>(job_queue, streams, num, output, length, depth);
+    else if (num <= 8)
+        new MergeJob<8>(job_queue, streams, num, output, length, depth);
+    else if (num <= 16)
+        new MergeJob<16>(job_queue, streams, num, output, length, depth);
+    else if (num <= 32)
+        new MergeJob<32>(job_queue, streams, num, output, length, depth);
+    else
+        new MergeJob<64>(job_queue, streams, num, output, length, depth);
+}
+
+/******************************************************************************/
+// LCP Splitting
+
+/*!
+ * Split sorted streams, whose strings all share depth characters, into merge
+ * jobs of about merge_size strings.
+ *
+ * A splitter key of key_type characters at depth is sampled about merge_size
+ * strings ahead in the longest stream, and all streams are cut at it by binary
+ * search, hence only O(K log n) strings are touched per merge job. If the
+ * strings with key equal to the splitter form a slice larger than merge_size
+ * in several streams, the slice is split again at the next depth by its own
+ * job, or copied if its strings are equal.
+ */
+struct SplitJob final : public Job
+{
+    const Context& ctx;
+    std::vector<LcpCacheStringPtr> streams;
+    string* output;
+    size_t length;
+    lcp_t depth;
+
+    SplitJob(JobQueue& job_queue, const Context& ctx,
+             const std::vector<LcpCacheStringPtr>& streams,
+             string* output, size_t length, lcp_t depth)
+        : ctx(ctx), streams(streams),
+          output(output), length(length), depth(depth)
+    {
+        job_queue.enqueue(this);
+    }
+
+    key_type key(const string& s) const
+    {
+        return get_char<key_type>(s, depth);
+    }
+
+    //! number of strings in s with key less than k, or with key less or equal
+    //! to k if upper is set
+    size_t bound(const LcpCacheStringPtr& s, key_type k, bool upper) const
+    {
+        size_t lo = 0, hi = s.size;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            key_type m = key(s.strings[mid]);
+            if (m < k || (upper && m == k))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    //! the streams between begin and end positions
+    static std::vector<LcpCacheStringPtr>
+    between(const std::vector<LcpCacheStringPtr>& begin,
+            const std::vector<LcpCacheStringPtr>& end)
+    {
+        std::vector<LcpCacheStringPtr> out(begin.size());
+        for (size_t i = 0; i < begin.size(); ++i)
+            out[i] = begin[i].sub(0, end[i] - begin[i]);
+        return out;
+    }
+
+    //! advance the streams by the counts
+    static std::vector<LcpCacheStringPtr>
+    advance(const std::vector<LcpCacheStringPtr>& pos,
+            const std::vector<size_t>& count)
+    {
+        std::vector<LcpCacheStringPtr> out(pos.size());
+        for (size_t i = 0; i < pos.size(); ++i)
+            out[i] = pos[i].sub(count[i], pos[i].size - count[i]);
+        return out;
+    }
+
+    virtual bool run(JobQueue& job_queue)
+    {
+        const size_t num = streams.size();
+
+        std::vector<LcpCacheStringPtr> pos = streams, lo, hi;
+        std::vector<size_t> lo_count(num), hi_count(num);
+
+        size_t rest = length;
+
+        while (rest > ctx.merge_size + ctx.merge_size / 2)
+        {
+            // sample the splitter from the longest stream, proportionally
+            size_t longest = 0;
+            for (size_t i = 1; i < num; ++i) {
+                if (pos[i].size > pos[longest].size) longest = i;
+            }
+
+            size_t step = ctx.merge_size * pos[longest].size / rest;
+            step = std::min(step, pos[longest].size - 1);
+            const key_type splitter = key(pos[longest].strings[step]);
+
+            size_t lo_size = 0, eq_size = 0, eq_streams = 0;
+            for (size_t i = 0; i < num; ++i)
+            {
+                lo_count[i] = bound(pos[i], splitter, false);
+                hi_count[i] = bound(pos[i], splitter, true);
+                lo_size += lo_count[i];
+                eq_size += hi_count[i] - lo_count[i];
+                eq_streams += (hi_count[i] != lo_count[i]);
+            }
+
+            hi = advance(pos, hi_count);
+
+            if (eq_size <= ctx.merge_size || eq_streams == 1)
+            {
+                enqueue_merge(job_queue, between(pos, hi),
+                              output, lo_size + eq_size, depth);
+                output += lo_size + eq_size;
+            }
+            else
+            {
+                // large slice of equal keys: merge the preceding strings
+                lo = advance(pos, lo_count);
+                if (lo_size) {
+                    enqueue_merge(job_queue, between(pos, lo),
+                                  output, lo_size, depth);
+                    output += lo_size;
+                }
+
+                // a zero in the key means the strings ended, they are equal
+                if ((splitter & 0xFF) == 0)
+                    new CopyJob(job_queue, between(lo, hi), output, eq_size);
+                else
+                    new SplitJob(job_queue, ctx, between(lo, hi), output,
+                                 eq_size, depth + sizeof(key_type));
+                output += eq_size;
+            }
+
+            rest -= lo_size + eq_size;
+            pos = hi;
+        }
+
+        if (rest)
+            enqueue_merge(job_queue, pos, output, rest, depth);
+
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "LCP SplitJob"; }
+
+    virtual size_t trace_size() const
+    { return length; }
+};
+
+/******************************************************************************/
+// Run Jobs
+
+//! sort one run of the input with the sequential K-way LCP mergesort, the
+//! last run starts the merge
+template <size_t K>
+struct RunJob final : public Job
+{
+    Context& ctx;
+    size_t r;
+    lcp_t depth;
+
+    RunJob(JobQueue& job_queue, Context& ctx, size_t r, lcp_t depth)
+        : ctx(ctx), r(r), depth(depth)
+    {
+        job_queue.enqueue(this);
+    }
+
+    virtual bool run(JobQueue& job_queue)
+    {
+        const size_t begin = ctx.n * r / ctx.runs.size();
+        bingmann::lcp_mergesort_cache_kway<K>(ctx.strings + begin, ctx.runs[r]);
+
+        // all runs are read before the merge overwrites the input
+        if (--ctx.pwork == 0)
+            new SplitJob(job_queue, ctx, ctx.runs, ctx.strings, ctx.n, depth);
+
+        return true;
+    }
+
+    virtual const char * trace_name() const
+    { return "LCP RunJob"; }
+
+    virtual size_t trace_size() const
+    { return ctx.runs[r].size; }
+};
+
+/******************************************************************************/
+// Frontends
+
+//! sort strings, which are all equal up to depth. Each run is sorted by a
+//! K-way LCP mergesort.
+template <size_t K>
+static inline
+void parallel_lcp_mergesort(string* strings, size_t n, size_t depth)
+{
+    Context ctx;
+    ctx.strings = strings;
+    ctx.n = n;
+
+    size_t runs = std::min<size_t>(omp_get_max_threads(), max_runs);
+    runs = std::max<size_t>(1, std::min(runs, n / min_job_size));
+
+    ctx.merge_size = std::max(min_job_size, n / (4 * omp_get_max_threads()));
+
+    ctx.runs.resize(runs);
+    for (size_t r = 0; r < runs; ++r)
+    {
+        size_t size = n * (r + 1) / runs - n * r / runs;
+        ctx.runs[r] = LcpCacheStringPtr(
+            new string[size], new lcp_t[size], new char_type[size], size);
+    }
+
+    ctx.pwork = runs;
+
+    JobQueue job_queue;
+    for (size_t r = 0; r < runs; ++r)
+        new RunJob<K>(job_queue, ctx, r, depth);
+    job_queue.loop();
+
+    for (size_t r = 0; r < runs; ++r)
+    {
+        delete[] ctx.runs[r].strings;
+        delete[] ctx.runs[r].lcps;
+        delete[] ctx.runs[r].cachedChars;
+    }
+}
+
+template <size_t K>
+static inline
+void parallel_lcp_mergesort(
+    const parallel_string_sorting::UCharStringSet& ss, size_t depth)
+{
+    parallel_lcp_mergesort<K>(ss.begin(), ss.size(), depth);
+}
+
+} // namespace bingmann_parallel_lcp_mergesort
+
+#endif // !PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LCP_MERGESORT_HEADER
+
+/******************************************************************************/
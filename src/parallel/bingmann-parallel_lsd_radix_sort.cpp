@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_lsd_radix_sort.cpp
+ *
+ * Parallel LSD radix sort for strings of equal length, see
+ * bingmann-parallel_lsd_radix_sort.hpp.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "bingmann-parallel_lsd_radix_sort.hpp"
+
+namespace bingmann_parallel_lsd_radix_sort {
+
+static inline void parallel_lsd_radix_sort_8bit(unsigned char** strings, size_t n)
+{
+    return parallel_lsd_radix_sort_8bit_generic(
+        parallel_string_sorting::UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_lsd_radix_sort_8bit,
+                        "bingmann/parallel_lsd_radix_sort_8bit",
+                        "Parallel LSD radix sort for equal length strings, 8-bit digits")
+
+static inline void parallel_lsd_radix_sort_16bit(unsigned char** strings, size_t n)
+{
+    return parallel_lsd_radix_sort_16bit_generic(
+        parallel_string_sorting::UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_lsd_radix_sort_16bit,
+                        "bingmann/parallel_lsd_radix_sort_16bit",
+                        "Parallel LSD radix sort for equal length strings, 16-bit digits")
+
+} // namespace bingmann_parallel_lsd_radix_sort
+
+/******************************************************************************/
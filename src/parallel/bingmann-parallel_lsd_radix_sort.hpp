@@ -0,0 +1,281 @@
+/*******************************************************************************
+ * src/parallel/bingmann-parallel_lsd_radix_sort.hpp
+ *
+ * Parallel LSD radix sort for strings of equal length, e.g. hashes or IDs.
+ *
+ * Each pass is a stable counting sort by one 8- or 16-bit digit, starting at
+ * the last digit. Threads count the digits of their part of the input into
+ * private histograms, which are then summed up in bucket-major order, and
+ * scatter their part into the other array. The 8-bit scatter collects strings
+ * in small software write-combining buffers per bucket and writes them out a
+ * cache line at a time. Passes where all strings have the same digit are
+ * skipped.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LSD_RADIX_SORT_HEADER
+#define PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LSD_RADIX_SORT_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <omp.h>
+
+#include "bingmann-parallel_sample_sort.hpp"
+#include "../tools/globals.hpp"
+
+namespace bingmann_parallel_lsd_radix_sort {
+
+//! number of strings collected per bucket in the write-combining buffers of
+//! the 8-bit scatter, one cache line of pointers
+static const size_t wc_size = 8;
+
+/*!
+ * Check in parallel whether all strings of ss have the same length beyond
+ * depth, which is returned in length.
+ */
+template <typename StringSet>
+bool fixed_length(const StringSet& ss, size_t depth, size_t& length)
+{
+    typedef typename StringSet::String String;
+    typedef typename StringSet::CharIterator CharIterator;
+
+    size_t n = ss.size();
+    length = 0;
+    if (n == 0) return true;
+
+    // length of first string
+    const String& s0 = ss.at(0);
+    for (CharIterator c = ss.get_chars(s0, depth); !ss.is_end(s0, c); ++c)
+        ++length;
+
+    // stop scanning all threads as soon as one found a different length
+    std::atomic<bool> equal(true);
+
+#pragma omp parallel for schedule(static)
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (!equal.load(std::memory_order_relaxed)) continue;
+
+        const String& s = ss.at(i);
+        CharIterator c = ss.get_chars(s, depth);
+
+        // scan at most one character beyond length
+        size_t l = 0;
+        while (l <= length && !ss.is_end(s, c)) ++c, ++l;
+        if (l != length)
+            equal.store(false, std::memory_order_relaxed);
+    }
+
+    return equal;
+}
+
+/*!
+ * Sort strings of ss which all have the given length beyond depth by LSD radix
+ * sort with Bits-bit digits. Returns the number of scatter passes run.
+ */
+template <size_t Bits, typename StringSet>
+size_t parallel_lsd_radix_sort(
+    const StringSet& ss, size_t length, size_t depth)
+{
+    static_assert(Bits == 8 || Bits == 16, "Bits must be 8 or 16");
+
+    typedef typename StringSet::String String;
+    typedef typename StringSet::Iterator Iterator;
+    typedef typename std::conditional<Bits == 8, uint8_t, uint16_t>::type
+        digit_type;
+
+    static const size_t K = size_t(1) << Bits;
+
+    //! number of write-combining buffers, only the 8-bit scatter uses them
+    static const size_t wc_num = (Bits == 8) ? K : 1;
+
+    size_t n = ss.size();
+    if (n <= 1 || length == 0) return 0;
+
+    typename StringSet::Container tmp = ss.allocate(n);
+    StringSet ts(tmp);
+
+    std::vector<digit_type> digit(n);
+    std::vector<size_t> bkt(omp_get_max_threads() * K);
+
+    // the thread reading a part of the temporary array in the next pass
+    // touches it first, which places its pages on that thread's NUMA node.
+    if (std::is_pod<String>::value)
+    {
+#pragma omp parallel
+        {
+            size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+            size_t begin = n * t / nthr, end = n * (t + 1) / nthr;
+            if (begin < end)
+                memset(static_cast<void*>(&*(ts.begin() + begin)), 0,
+                       (end - begin) * sizeof(String));
+        }
+    }
+
+    // source and destination of the current pass
+    Iterator src = ss.begin(), dst = ts.begin();
+    bool in_tmp = false;
+    size_t passes = 0;
+
+    for (size_t d = length; d > 0; )
+    {
+        // digit at position pos with width chars, a first odd 16-bit digit
+        // has only one character.
+        size_t width = (Bits == 16 && d >= 2) ? 2 : 1;
+        d -= width;
+        size_t pos = depth + d;
+
+        bool skip = false;
+
+#pragma omp parallel
+        {
+            size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+            size_t begin = n * t / nthr, end = n * (t + 1) / nthr;
+
+            // count digits of this thread's part into its own histogram
+            size_t* mybkt = bkt.data() + t * K;
+            std::fill(mybkt, mybkt + K, 0);
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const String& s = *(src + i);
+                size_t dg = static_cast<unsigned char>(ss.get_char(s, pos));
+                if (width == 2)
+                    dg = (dg << 8) | static_cast<unsigned char>(
+                        ss.get_char(s, pos + 1));
+                digit[i] = static_cast<digit_type>(dg);
+                ++mybkt[dg];
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+                // exclusive prefix sum in bucket-major, thread-minor order,
+                // which keeps the pass stable.
+                size_t sum = 0;
+                for (size_t k = 0; k < K; ++k)
+                {
+                    size_t begin_k = sum;
+                    for (size_t p = 0; p < nthr; ++p) {
+                        size_t c = bkt[p * K + k];
+                        bkt[p * K + k] = sum;
+                        sum += c;
+                    }
+                    if (sum - begin_k == n) skip = true;
+                }
+            }
+
+            if (!skip && Bits == 8)
+            {
+                // scatter through write-combining buffers
+                std::vector<String> wc(wc_num * wc_size);
+                unsigned char fill[wc_num];
+                memset(fill, 0, sizeof(fill));
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    size_t dg = digit[i];
+                    wc[dg * wc_size + fill[dg]] = std::move(*(src + i));
+
+                    if (++fill[dg] == wc_size) {
+                        Iterator out = dst + mybkt[dg];
+                        for (size_t j = 0; j < wc_size; ++j)
+                            *out++ = std::move(wc[dg * wc_size + j]);
+                        mybkt[dg] += wc_size;
+                        fill[dg] = 0;
+                    }
+                }
+
+                for (size_t dg = 0; dg < wc_num; ++dg) {
+                    Iterator out = dst + mybkt[dg];
+                    for (size_t j = 0; j < fill[dg]; ++j)
+                        *out++ = std::move(wc[dg * wc_size + j]);
+                }
+            }
+            else if (!skip)
+            {
+                // 65536 buffers would not fit into the cache, scatter directly
+                for (size_t i = begin; i < end; ++i)
+                    *(dst + mybkt[digit[i]]++) = std::move(*(src + i));
+            }
+        }
+
+        if (skip) continue;
+
+        std::swap(src, dst);
+        in_tmp = !in_tmp;
+        ++passes;
+    }
+
+    if (in_tmp)
+    {
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i)
+            *(dst + i) = std::move(*(src + i));
+    }
+
+    StringSet::deallocate(tmp);
+
+    return passes;
+}
+
+/*!
+ * Sort ss by LSD radix sort if all strings have the same length, otherwise
+ * fall back to pS5, which handles varying lengths.
+ */
+template <size_t Bits, typename StringSet>
+void parallel_lsd_radix_sort_generic(const StringSet& ss, size_t depth)
+{
+    size_t length;
+    if (!fixed_length(ss, depth, length))
+    {
+        g_stats >> "lsd_fixed_length" << 0;
+        bingmann_parallel_sample_sort::parallel_sample_sort_base(ss, depth);
+        return;
+    }
+
+    size_t passes = parallel_lsd_radix_sort<Bits>(ss, length, depth);
+
+    g_stats >> "lsd_fixed_length" << length
+        >> "lsd_passes" << passes;
+}
+
+//! Sort strings of equal length by LSD radix sort with 8-bit digits.
+template <typename StringSet>
+void parallel_lsd_radix_sort_8bit_generic(const StringSet& ss, size_t depth)
+{
+    parallel_lsd_radix_sort_generic<8>(ss, depth);
+}
+
+//! Sort strings of equal length by LSD radix sort with 16-bit digits.
+template <typename StringSet>
+void parallel_lsd_radix_sort_16bit_generic(const StringSet& ss, size_t depth)
+{
+    parallel_lsd_radix_sort_generic<16>(ss, depth);
+}
+
+} // namespace bingmann_parallel_lsd_radix_sort
+
+#endif // !PSS_SRC_PARALLEL_BINGMANN_PARALLEL_LSD_RADIX_SORT_HEADER
+
+/******************************************************************************/
@@ -46,6 +46,22 @@ PSS_CONTESTANT_PARALLEL(bingmann_parallel_mkqs,
                         "bingmann/parallel_mkqs",
                         "Parallel MKQS with blocks and cache8")
 
+static inline
+void bingmann_parallel_mkqs_offset(unsigned char** strings, size_t n)
+{
+    using parallel_string_sorting::UCharOffsetStringSet;
+
+    if (!parallel_string_sorting::sort_as_offsets(
+            strings, n, [](const UCharOffsetStringSet& ss) {
+                bingmann_parallel_mkqs(ss, 0);
+            }))
+        bingmann_parallel_mkqs(strings, n);
+}
+
+PSS_CONTESTANT_PARALLEL(bingmann_parallel_mkqs_offset,
+                        "bingmann/parallel_mkqs_offset",
+                        "Parallel MKQS with blocks and cache8, 32-bit offsets")
+
 } // namespace bingmann_parallel_mkqs
 
 /******************************************************************************/
@@ -23,6 +23,7 @@
 #ifndef PSS_SRC_PARALLEL_BINGMANN_PARALLEL_MKQS_HEADER
 #define PSS_SRC_PARALLEL_BINGMANN_PARALLEL_MKQS_HEADER
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -209,6 +210,21 @@ public:
         }
     }
 
+    //! Sort strings whose keys are equal and end with a zero character. These
+    //! are equal, except if the StringSet is binary_safe, then sort them by
+    //! comparison from depth on.
+    static inline void
+    sort_zero_bucket(const StringSet& strset, StrCache* cache,
+                     size_t n, size_t depth)
+    {
+        if (!StringSet::binary_safe) return;
+
+        std::sort(cache, cache + n,
+                  [&strset, depth](const StrCache& a, const StrCache& b) {
+                      return strset.is_less_at(a.str, b.str, depth);
+                  });
+    }
+
     //! Insertion sorts the strings only based on the cached characters.
     static inline void
     insertion_sort_cache_block(StrCache* cache, size_t n)
@@ -244,12 +260,16 @@ public:
             if (cnt > 1 && cache[start].key & 0xFF)
                 insertion_sort_nocache(strset, cache + start, cnt,
                                        depth + sizeof(key_type));
+            else if (cnt > 1)
+                sort_zero_bucket(strset, cache + start, cnt, depth);
             cnt = 1;
             start = i + 1;
         }
         if (cnt > 1 && cache[start].key & 0xFF)
             insertion_sort_nocache(strset, cache + start, cnt,
                                    depth + sizeof(key_type));
+        else if (cnt > 1)
+            sort_zero_bucket(strset, cache + start, cnt, depth);
     }
 
     // *************************************************************************
@@ -405,6 +425,12 @@ public:
             jobqueue.enqueue(this);
         }
 
+        const char * trace_name() const final
+        { return "MKQS SequentialJob"; }
+
+        size_t trace_size() const final
+        { return strset.size(); }
+
         // *** Sequential Work
 
         bool run(JobQueue& jobqueue) final
@@ -560,6 +586,9 @@ jumpout:
                                     << ctx.srange(strset.subr(st_strings + st.num_lt, st.num_eq))
                                     << " - no recurse equal @ job " << this;
 
+                                sort_zero_bucket(strset, st.cache + st.num_lt,
+                                                 st.num_eq, st.depth);
+
                                 // seems overkill to create an extra thread job for this:
                                 for (size_t i = st.num_lt; i < st.num_lt + st.num_eq; ++i)
                                     st_strings[i] = std::move(st.cache[i].str);
@@ -614,8 +643,11 @@ jumpout:
                     // process the eq-subsequence
                     else if (ms.idx == 2)
                     {
-                        if (!ms.eq_recurse || ms.num_eq == 0)
+                        if (!ms.eq_recurse || ms.num_eq == 0) {
+                            sort_zero_bucket(strset, ms.cache + ms.num_lt,
+                                             ms.num_eq, ms.depth);
                             continue;
+                        }
                         else if (ms.num_eq < g_inssort_threshold)
                             insertion_sort<true>(
                                 strset, ms.cache + ms.num_lt, ms.num_eq,
@@ -898,6 +930,12 @@ jumpout:
                 step->partition(p, jobqueue);
                 return true;
             }
+
+            const char * trace_name() const final
+            { return "MKQS PartitionJob"; }
+
+            size_t trace_size() const final
+            { return step->blks.strset.size() / step->procs; }
         };
 
         // *** Lock-free Queues for Finished Blocks
@@ -1191,6 +1229,16 @@ jump2:
 
             // recurse into eq-queue
             if (count_eq == 0) { }
+            else if (StringSet::binary_safe && !(pivot & 0xFF)) {
+                // equal binary strings may still differ beyond the key, let
+                // the sequential sort finish them at the same depth.
+                new SequentialJob<false>(
+                    ctx, jobqueue,
+                    blks.strset.subi(count_lt, count_lt + count_eq),
+                    blks.depth,
+                    oblk_eq);
+                delete oblk_eq_pivot;
+            }
             else if (count_eq <= ctx.g_sequential_threshold) {
                 new SequentialJob<true>(
                     ctx, jobqueue,
@@ -71,6 +71,36 @@ PSS_CONTESTANT_PARALLEL(parallel_radix_sort_16bit,
                         "bingmann/parallel_radix_sort_16bit",
                         "Parallel MSD Radix sort with load balancing, 16-bit BigSorts")
 
+static inline void parallel_radix_sort_8bit_offset(string* strings, size_t n)
+{
+    using parallel_string_sorting::UCharOffsetStringSet;
+
+    if (!parallel_string_sorting::sort_as_offsets(
+            strings, n, [](const UCharOffsetStringSet& ss) {
+                parallel_radix_sort_8bit_generic(ss, /* depth */ 0);
+            }))
+        parallel_radix_sort_8bit(strings, n);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_radix_sort_8bit_offset,
+                        "bingmann/parallel_radix_sort_8bit_offset",
+                        "Parallel MSD Radix sort with load balancing, 8-bit BigSorts, 32-bit offsets")
+
+static inline void parallel_radix_sort_16bit_offset(string* strings, size_t n)
+{
+    using parallel_string_sorting::UCharOffsetStringSet;
+
+    if (!parallel_string_sorting::sort_as_offsets(
+            strings, n, [](const UCharOffsetStringSet& ss) {
+                parallel_radix_sort_16bit_generic(ss, /* depth */ 0);
+            }))
+        parallel_radix_sort_16bit(strings, n);
+}
+
+PSS_CONTESTANT_PARALLEL(parallel_radix_sort_16bit_offset,
+                        "bingmann/parallel_radix_sort_16bit_offset",
+                        "Parallel MSD Radix sort with load balancing, 16-bit BigSorts, 32-bit offsets")
+
 } // namespace bingmann_parallel_radix_sort
 
 /******************************************************************************/
@@ -66,9 +66,9 @@ static const bool use_work_sharing = true;
 
 static const size_t g_inssort_threshold = 32;
 
-size_t g_totalsize;             // total size of input
-size_t g_sequential_threshold;  // calculated threshold for sequential sorting
-size_t g_threadnum;             // number of threads overall
+static size_t g_totalsize;             // total size of input
+static size_t g_sequential_threshold;  // calculated threshold for sequential sorting
+static size_t g_threadnum;             // number of threads overall
 
 /// Prototype called to schedule deeper sorts
 template <typename bigsort_key_type, typename StringPtr>
@@ -99,6 +99,12 @@ struct SmallsortJob8 final : public Job
         job_queue.enqueue(this);
     }
 
+    virtual const char * trace_name() const
+    { return "Radix SmallsortJob8"; }
+
+    virtual size_t trace_size() const
+    { return strptr.size(); }
+
     struct RadixStep8_CI
     {
         StringPtr    strptr;
@@ -159,6 +165,10 @@ struct SmallsortJob8 final : public Job
             }
             assert(bkt[256] == n);
 
+            // bkt 0 contains strings ending at depth, or binary zero characters
+            if (bkt[1] > 1)
+                finish_zero_bucket(strptr.sub(0, bkt[1]), depth);
+
             idx = 0; // will increment to 1 on first process, bkt 0 is not sorted further
         }
     };
@@ -271,6 +281,12 @@ struct SmallsortJob16 final : public Job
         job_queue.enqueue(this);
     }
 
+    virtual const char * trace_name() const
+    { return "Radix SmallsortJob16"; }
+
+    virtual size_t trace_size() const
+    { return strptr.size(); }
+
     struct RadixStep16_CI
     {
         typedef uint16_t key_type;
@@ -473,6 +489,12 @@ struct CountJob final : public Job
         step->count(p, job_queue);
         return true;
     }
+
+    virtual const char * trace_name() const
+    { return "Radix CountJob"; }
+
+    virtual size_t trace_size() const
+    { return step->psize; }
 };
 
 template <typename key_type, typename StringPtr>
@@ -489,6 +511,12 @@ struct DistributeJob final : public Job
         step->distribute(p, job_queue);
         return true;
     }
+
+    virtual const char * trace_name() const
+    { return "Radix DistributeJob"; }
+
+    virtual size_t trace_size() const
+    { return step->psize; }
 };
 
 template <typename key_type, typename StringPtr>
@@ -629,7 +657,7 @@ void RadixStepCE<key_type, StringPtr>::distribute_finished(JobQueue& job_queue)
         bkt[numbkts] = strptr.size();
 
         // maybe copy back finished pointers from shadow
-        strptr.flip(0, bkt[1] - bkt[0]).copy_back();
+        finish_zero_bucket(strptr.flip(0, bkt[1] - bkt[0]).copy_back(), depth);
 
         for (size_t i = 1; i < numbkts; ++i)
         {
@@ -649,13 +677,18 @@ void RadixStepCE<key_type, StringPtr>::distribute_finished(JobQueue& job_queue)
         bkt[numbkts] = strptr.size();
 
         // maybe copy back finished pointers from shadow
-        strptr.flip(0, bkt[0x0101] - bkt[0]).copy_back();
+        finish_zero_bucket(strptr.flip(0, bkt[1] - bkt[0]).copy_back(), depth);
+
+        // buckets 0x00?? are only filled by binary zero characters
+        size_t first = StringSet::binary_safe ? 0x0001 : 0x0100;
 
-        for (size_t i = 0x0101; i < numbkts; ++i)
+        for (size_t i = first; i < numbkts; ++i)
         {
             // skip over finished buckets 0x??00
             if ((i & 0x00FF) == 0) {
-                strptr.flip(bkt[i], bkt[i + 1] - bkt[i]).copy_back();
+                finish_zero_bucket(
+                    strptr.flip(bkt[i], bkt[i + 1] - bkt[i]).copy_back(),
+                    depth + 1);
                 continue;
             }
 
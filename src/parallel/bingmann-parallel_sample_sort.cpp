@@ -41,6 +41,24 @@ PSS_CONTESTANT_PARALLEL(
     "bingmann/parallel_sample_sortBTCUI",
     "pS5: binary tree, bktcache, unroll tree and strings")
 
+static inline void
+parallel_sample_sortBTCUI_offset(string* strings, size_t n)
+{
+    using parallel_string_sorting::UCharOffsetStringSet;
+
+    if (!parallel_string_sorting::sort_as_offsets(
+            strings, n, [](const UCharOffsetStringSet& ss) {
+                parallel_sample_sort_base<
+                    bingmann_sample_sort::ClassifyTreeUnrollInterleaveX>(ss, 0);
+            }))
+        parallel_sample_sortBTCUI(strings, n);
+}
+
+PSS_CONTESTANT_PARALLEL(
+    parallel_sample_sortBTCUI_offset,
+    "bingmann/parallel_sample_sortBTCUI_offset",
+    "pS5: binary tree, bktcache, unroll tree and strings, 32-bit offsets")
+
 static inline void
 parallel_sample_sortBTCUI_out(string* strings, size_t n)
 {
@@ -91,6 +109,38 @@ PSS_CONTESTANT_PARALLEL(
     "bingmann/parallel_sample_sortBTCTUI",
     "pS5: binary tree, bktcache, unroll tree, tree calc")
 
+/*----------------------------------------------------------------------------*/
+
+static inline void
+parallel_sample_sortKTS(string* strings, size_t n)
+{
+    g_stats >> "simd" << bingmann_sample_sort::simd_level_name(
+        bingmann_sample_sort::simd_level_detect());
+
+    parallel_sample_sort_base<
+        bingmann_sample_sort::ClassifySimdTree>(
+        UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(
+    parallel_sample_sortKTS,
+    "bingmann/parallel_sample_sortKTS",
+    "pS5: k-ary SIMD tree, bktcache")
+
+static inline void
+parallel_sample_sortBTCTUI_stable(string* strings, size_t n)
+{
+    parallel_sample_sort_base<
+        bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+        /* Stable */ true>(
+        UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(
+    parallel_sample_sortBTCTUI_stable,
+    "bingmann/parallel_sample_sortBTCTUI_stable",
+    "pS5: binary tree, bktcache, unroll tree, tree calc, stable")
+
 /******************************************************************************/
 // Parallel Sample Sort with LCP Instantiations
 
@@ -137,6 +187,40 @@ PSS_CONTESTANT_PARALLEL(
     "bingmann/parallel_sample_sortBTCTUI_lcp",
     "pS5: binary tree, bktcache, unroll tree, tree calc")
 
+/*----------------------------------------------------------------------------*/
+
+static inline void
+parallel_sample_sortBTCTUI_stable_lcp(string* strings, size_t n)
+{
+    parallel_sample_sort_lcp_base<
+        bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+        /* Stable */ true>(
+        UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(
+    parallel_sample_sortBTCTUI_stable_lcp,
+    "bingmann/parallel_sample_sortBTCTUI_stable_lcp",
+    "pS5: binary tree, bktcache, unroll tree, tree calc, stable")
+
+/*----------------------------------------------------------------------------*/
+
+static inline void
+parallel_sample_sortKTS_lcp(string* strings, size_t n)
+{
+    g_stats >> "simd" << bingmann_sample_sort::simd_level_name(
+        bingmann_sample_sort::simd_level_detect());
+
+    parallel_sample_sort_lcp_base<
+        bingmann_sample_sort::ClassifySimdTree>(
+        UCharStringSet(strings, strings + n), 0);
+}
+
+PSS_CONTESTANT_PARALLEL(
+    parallel_sample_sortKTS_lcp,
+    "bingmann/parallel_sample_sortKTS_lcp",
+    "pS5: k-ary SIMD tree, bktcache")
+
 } // namespace bingmann_parallel_sample_sort
 
 /******************************************************************************/
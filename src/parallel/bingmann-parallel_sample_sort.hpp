@@ -31,20 +31,24 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <numeric>
 
 #include "../tools/lcgrandom.hpp"
 #include "../tools/contest.hpp"
 #include "../tools/stringtools.hpp"
 #include "../tools/jobqueue.hpp"
 #include "../tools/lockfree.hpp"
+#include "../tools/threadpool.hpp"
 
 #include "../sequential/inssort.hpp"
 #include "../sequential/bingmann-lcp_inssort.hpp"
+#include "../sequential/bingmann-lcp_mergesort_binary.hpp"
 #include "../sequential/bingmann-sample_sort_tree_builder.hpp"
 #include "../sequential/bingmann-sample_sortBSC.hpp"
 #include "../sequential/bingmann-sample_sortBTC.hpp"
 #include "../sequential/bingmann-sample_sortBTCE.hpp"
 #include "../sequential/bingmann-sample_sortBTCT.hpp"
+#include "../sequential/bingmann-sample_sortKTS.hpp"
 
 #include <tlx/string/hexdump.hpp>
 #include <tlx/meta/log2.hpp>
@@ -118,7 +122,8 @@ typedef ::ScopedTimerKeeperDummy ScopedTimerKeeperMT;
 // *** Global Parallel Super Scalar String Sample Sort Context
 
 template <bool CalcLcp_,
-          template <typename> class JobQueueGroupType = DefaultJobQueueGroup>
+          template <typename> class JobQueueGroupType = DefaultJobQueueGroup,
+          bool Stable_ = false>
 class Context
 {
 public:
@@ -132,6 +137,10 @@ public:
 
     static const bool CalcLcp = CalcLcp_;
 
+    //! keep input order of equal strings: distribute stably and sort small
+    //! buckets with LCP-mergesort instead of multikey quicksort.
+    static const bool Stable = Stable_;
+
     //! number of threads overall
     size_t threadnum;
 
@@ -305,6 +314,73 @@ insertion_sort(const stringtools::StringShadowLcpCacheOutPtr<StringSet>& strptr,
         strptr.output(), strptr.lcparray(), strptr.cache(), depth);
 }
 
+// ****************************************************************************
+// *** Stable LCP-Mergesort Type-Switch
+
+template <typename StringSet>
+static inline void
+stable_sort(const stringtools::StringShadowPtr<StringSet>& strptr,
+            size_t depth)
+{
+    assert(!strptr.flipped());
+
+    std::vector<uintptr_t> lcp(strptr.size());
+    bingmann::lcp_mergesort_binary_generic(strptr.output(), lcp.data(), depth);
+}
+
+template <typename StringSet>
+static inline void
+stable_sort(const stringtools::StringShadowOutPtr<StringSet>& strptr,
+            size_t depth)
+{
+    assert(!strptr.flipped());
+
+    std::vector<uintptr_t> lcp(strptr.size());
+    bingmann::lcp_mergesort_binary_generic(strptr.output(), lcp.data(), depth);
+}
+
+//! LCP-mergesort into the LCP array, but keep lcp[0] of the subarray, which
+//! belongs to the enclosing bucket.
+template <typename StringPtr>
+static inline void
+stable_sort_lcp(const StringPtr& strptr, size_t depth)
+{
+    assert(!strptr.flipped());
+
+    uintptr_t lcp0 = strptr.lcparray()[0];
+    bingmann::lcp_mergesort_binary_generic(
+        strptr.output(), strptr.lcparray(), depth);
+    strptr.lcparray()[0] = lcp0;
+}
+
+template <typename StringSet>
+static inline void
+stable_sort(const stringtools::StringShadowLcpPtr<StringSet>& strptr,
+            size_t depth)
+{
+    stable_sort_lcp(strptr, depth);
+}
+
+template <typename StringSet>
+static inline void
+stable_sort(const stringtools::StringShadowLcpOutPtr<StringSet>& strptr,
+            size_t depth)
+{
+    stable_sort_lcp(strptr, depth);
+}
+
+template <typename StringSet>
+static inline void
+stable_sort(const stringtools::StringShadowLcpCacheOutPtr<StringSet>& strptr,
+            size_t depth)
+{
+    stable_sort_lcp(strptr, depth);
+
+    const StringSet& ss = strptr.output();
+    for (size_t i = 1; i < strptr.size(); ++i)
+        strptr.set_cache(i, ss.get_char(ss.at(i), strptr.lcp(i)));
+}
+
 // ****************************************************************************
 // *** LCP Calculation for finished Sample Sort Steps
 
@@ -395,12 +471,36 @@ even_bucket:
     }
 }
 
+/*!
+ * For partial sorting: cut off all buckets starting at or beyond position
+ * limit, their strings are not needed for the first limit positions. The
+ * strings are only moved back from the shadow array and all cut buckets are
+ * made empty in bkt. Returns the number of strings left unsorted.
+ */
+template <size_t bktnum, typename StringPtr, typename BktSizeType>
+size_t cut_buckets_at_limit(const StringPtr& strptr, BktSizeType* bkt,
+                            size_t limit)
+{
+    size_t n = strptr.size();
+    if (limit >= n) return 0;
+
+    size_t b = std::lower_bound(bkt, bkt + bktnum + 1, limit) - bkt;
+    size_t cut = bkt[b];
+
+    strptr.flip(cut, n - cut).copy_back();
+    for (size_t i = b + 1; i <= bktnum; ++i)
+        bkt[i] = cut;
+
+    return n - cut;
+}
+
 // ****************************************************************************
 // *** SampleSort non-recursive in-place sequential sample sort for small sorts
 
+//! Enqueue a sort job for strptr, only the first limit positions are sorted.
 template <template <size_t> class Classify, typename Context, typename StringPtr>
 void Enqueue(Context& ctx, SortStep* sstep,
-             const StringPtr& strptr, size_t depth);
+             const StringPtr& strptr, size_t depth, size_t limit = size_t(-1));
 
 template <typename Context, template <size_t> class Classify,
           typename StringPtr, typename BktSizeType>
@@ -414,14 +514,17 @@ public:
 
     StringPtr in_strptr;
     size_t in_depth;
+    //! number of leading positions to sort, less than size for partial sorts
+    size_t in_limit;
 
     typedef typename StringPtr::StringSet StringSet;
 
     typedef BktSizeType bktsize_type;
 
     SmallsortJob(SortStep* pstep,
-                 const StringPtr& strptr, size_t depth)
-        : pstep(pstep), in_strptr(strptr), in_depth(depth)
+                 const StringPtr& strptr, size_t depth, size_t limit)
+        : pstep(pstep), in_strptr(strptr), in_depth(depth),
+          in_limit(std::min(limit, strptr.size()))
     {
         LOGC(debug_steps)
             << "enqueue depth=" << in_depth
@@ -434,6 +537,7 @@ public:
         StringPtr strptr;
         size_t idx;
         size_t depth;
+        size_t limit;
 
         Classify<bingmann_sample_sort::DefaultTreebits> classifier;
 
@@ -445,8 +549,8 @@ public:
         bktsize_type bkt[bktnum + 1];
 
         SeqSampleSortStep(Context& ctx, const StringPtr& _strptr, size_t _depth,
-                          uint16_t* bktcache)
-            : strptr(_strptr), idx(0), depth(_depth)
+                          size_t _limit, uint16_t* bktcache)
+            : strptr(_strptr), idx(0), depth(_depth), limit(_limit)
         {
             size_t n = strptr.size();
 
@@ -498,9 +602,19 @@ public:
             const StringSet& sorted = strptr.shadow();
             typename StringSet::Iterator sbegin = sorted.begin();
 
-            for (typename StringSet::Iterator str = strB.begin();
-                 str != strB.end(); ++str, ++bktcache)
-                *(sbegin + --bkt[*bktcache]) = std::move(*str);
+            if (!Context::Stable) {
+                for (typename StringSet::Iterator str = strB.begin();
+                     str != strB.end(); ++str, ++bktcache)
+                    *(sbegin + --bkt[*bktcache]) = std::move(*str);
+            }
+            else {
+                // fill buckets backwards from the last string, which keeps
+                // the input order inside each bucket.
+                bktcache += n;
+                for (typename StringSet::Iterator str = strB.end();
+                     str != strB.begin(); )
+                    *(sbegin + --bkt[*--bktcache]) = std::move(*--str);
+            }
 
             // bkt is afterwards the exclusive prefix sum of bktsize
 
@@ -525,6 +639,12 @@ public:
     size_t ss_pop_front;
     std::vector<SeqSampleSortStep> ss_stack;
 
+    const char * trace_name() const final
+    { return "pS5 SmallsortJob"; }
+
+    size_t trace_size() const final
+    { return in_strptr.size(); }
+
     bool run(Context& ctx) final
     {
         ScopedTimerKeeperMT tm_seq_ss(ctx.timers, TM_SEQ_SS);
@@ -533,7 +653,7 @@ public:
 
         LOGC(debug_jobs) << "Process SmallsortJob " << this << " of size " << n;
 
-        thrid = PS5_ENABLE_RESTSIZE ? omp_get_thread_num() : 0;
+        thrid = PS5_ENABLE_RESTSIZE ? ThreadPool::thread_num() : 0;
 
         // create anonymous wrapper job
         this->substep_add();
@@ -545,16 +665,16 @@ public:
 
         if (enable_sequential_sample_sort && n >= g_smallsort_threshold)
         {
-            bktcache = new uint16_t[n];
+            bktcache = hugepage::allocate_array<uint16_t>(n);
             bktcache_size = n * sizeof(uint16_t);
-            sort_sample_sort(ctx, in_strptr, in_depth);
+            sort_sample_sort(ctx, in_strptr, in_depth, in_limit);
         }
         else
         {
             sort_mkqs_cache(ctx, in_strptr, in_depth);
         }
 
-        delete[] bktcache;
+        hugepage::deallocate(bktcache);
 
         // finish wrapper job, handler delete's this
         this->substep_notify_done();
@@ -562,7 +682,20 @@ public:
         return false;
     }
 
-    void sort_sample_sort(Context& ctx, const StringPtr& strptr, size_t depth)
+    //! push a sample sort step onto the stack and cut off its buckets beyond
+    //! the limit of a partial sort.
+    void push_sample_sort_step(Context& ctx, const StringPtr& strptr,
+                               size_t depth, size_t limit)
+    {
+        ss_stack.emplace_back(ctx, strptr, depth, limit, bktcache);
+
+        SeqSampleSortStep& s = ss_stack.back();
+        ctx.donesize(cut_buckets_at_limit<SeqSampleSortStep::bktnum>(
+                         s.strptr, s.bkt, limit), thrid);
+    }
+
+    void sort_sample_sort(Context& ctx, const StringPtr& strptr, size_t depth,
+                          size_t limit)
     {
         typedef SeqSampleSortStep Step;
 
@@ -570,7 +703,7 @@ public:
         assert(ss_stack.size() == 0);
 
         // sort first level
-        ss_stack.emplace_back(ctx, strptr, depth, bktcache);
+        push_sample_sort_step(ctx, strptr, depth, limit);
 
         // step 5: "recursion"
 
@@ -618,8 +751,9 @@ public:
                                 << i << " size " << bktsize << " lcp "
                                 << int(s.splitter_lcp[i / 2] & 0x7F);
 
-                        ss_stack.emplace_back(
-                            ctx, sp, s.depth + (s.splitter_lcp[i / 2] & 0x7F), bktcache);
+                        push_sample_sort_step(
+                            ctx, sp, s.depth + (s.splitter_lcp[i / 2] & 0x7F),
+                            s.limit - s.bkt[i]);
                     }
                 }
                 // i is odd -> bkt[i] is equal bucket
@@ -632,11 +766,9 @@ public:
                         LOGC(debug_recursion)
                             << "Recurse[" << s.depth << "]: = bkt "
                             << i << " size " << bktsize << " is done!";
-                        StringPtr spb = sp.copy_back();
-
-                        if (Context::CalcLcp)
-                            spb.fill_lcp(
-                                s.depth + lcpKeyDepth(s.classifier.get_splitter(i / 2)));
+                        finish_zero_bucket(
+                            sp.copy_back(),
+                            s.depth + lcpKeyDepth(s.classifier.get_splitter(i / 2)));
                         ctx.donesize(bktsize, thrid);
                     }
                     else if (bktsize < g_smallsort_threshold)
@@ -653,8 +785,9 @@ public:
                             << "Recurse[" << s.depth << "]: = bkt "
                             << i << " size " << bktsize << " lcp keydepth!";
 
-                        ss_stack.emplace_back(
-                            ctx, sp, s.depth + sizeof(key_type), bktcache);
+                        push_sample_sort_step(
+                            ctx, sp, s.depth + sizeof(key_type),
+                            s.limit - s.bkt[i]);
                     }
                 }
             }
@@ -718,7 +851,8 @@ public:
 
                     this->substep_add();
                     Enqueue<Classify>(ctx, this, sp,
-                                      s.depth + (s.splitter_lcp[i / 2] & 0x7F));
+                                      s.depth + (s.splitter_lcp[i / 2] & 0x7F),
+                                      s.limit - s.bkt[i]);
                 }
             }
             // i is odd -> bkt[i] is equal bucket
@@ -731,10 +865,9 @@ public:
                     LOGC(debug_recursion)
                         << "Recurse[" << s.depth << "]: = bkt "
                         << i << " size " << bktsize << " is done!";
-                    StringPtr spb = sp.copy_back();
-
-                    if (Context::CalcLcp)
-                        spb.fill_lcp(s.depth + lcpKeyDepth(s.classifier.get_splitter(i / 2)));
+                    finish_zero_bucket(
+                        sp.copy_back(),
+                        s.depth + lcpKeyDepth(s.classifier.get_splitter(i / 2)));
                     ctx.donesize(bktsize, thrid);
                 }
                 else
@@ -745,7 +878,8 @@ public:
 
                     this->substep_add();
                     Enqueue<Classify>(
-                        ctx, this, sp, s.depth + sizeof(key_type));
+                        ctx, this, sp, s.depth + sizeof(key_type),
+                        s.limit - s.bkt[i]);
                 }
             }
         }
@@ -835,7 +969,8 @@ public:
                 }
                 else {
                     // cache contains NULL-termination
-                    strptr.sub(start, bktsize).fill_lcp(depth + lcpKeyDepth(cache[start]));
+                    finish_zero_bucket(strptr.sub(start, bktsize),
+                                       depth + lcpKeyDepth(cache[start]));
                 }
             }
             bktsize = 1;
@@ -855,7 +990,8 @@ public:
             }
             else {
                 // cache contains NULL-termination
-                strptr.sub(start, bktsize).fill_lcp(depth + lcpKeyDepth(cache[start]));
+                finish_zero_bucket(strptr.sub(start, bktsize),
+                                   depth + lcpKeyDepth(cache[start]));
             }
         }
     }
@@ -1057,6 +1193,16 @@ public:
     {
         ScopedTimerKeeperMT tm_mkqs(ctx.timers, TM_MKQS);
 
+        if (Context::Stable) {
+            LOGC(debug_jobs)
+                << "stable_sort() size "
+                << strptr.size() << " depth " << depth;
+
+            stable_sort(strptr.copy_back(), depth);
+            ctx.donesize(strptr.size(), thrid);
+            return;
+        }
+
         if (!enable_sequential_mkqs ||
             strptr.size() < g_inssort_threshold) {
             LOGC(debug_jobs)
@@ -1073,8 +1219,8 @@ public:
             << "sort_mkqs_cache() size " << strptr.size() << " depth " << depth;
 
         if (bktcache_size < strptr.size() * sizeof(key_type)) {
-            delete[] bktcache;
-            bktcache = (uint16_t*)new key_type[strptr.size()];
+            hugepage::deallocate(bktcache);
+            bktcache = (uint16_t*)hugepage::allocate_array<key_type>(strptr.size());
             bktcache_size = strptr.size() * sizeof(key_type);
         }
 
@@ -1120,9 +1266,9 @@ public:
                 if (!ms.eq_recurse) {
                     StringPtr spb = sp.copy_back();
 #if PS5_CALC_LCP_MKQS == 1
-                    spb.fill_lcp(ms.depth + ms.lcp_eq);
+                    finish_zero_bucket(spb, ms.depth + ms.lcp_eq);
 #elif PS5_CALC_LCP_MKQS == 2
-                    spb.fill_lcp(ms.depth + lcpKeyDepth(ms.pivot));
+                    finish_zero_bucket(spb, ms.depth + lcpKeyDepth(ms.pivot));
 #endif
                     ctx.donesize(spb.size(), thrid);
                 }
@@ -1214,9 +1360,9 @@ public:
                 else {
                     StringPtr spb = sp.copy_back();
 #if PS5_CALC_LCP_MKQS == 1
-                    spb.fill_lcp(ms.depth + ms.lcp_eq);
+                    finish_zero_bucket(spb, ms.depth + ms.lcp_eq);
 #elif PS5_CALC_LCP_MKQS == 2
-                    spb.fill_lcp(ms.depth + lcpKeyDepth(ms.pivot));
+                    finish_zero_bucket(spb, ms.depth + lcpKeyDepth(ms.pivot));
 #else
                     UNUSED(spb);
 #endif
@@ -1278,6 +1424,9 @@ public:
     StringPtr strptr;
     size_t depth;
 
+    //! number of leading positions to sort, less than size for partial sorts
+    size_t limit;
+
     //! number of parts into which the strings were split
     size_t parts;
     //! size of all parts except the last
@@ -1318,6 +1467,12 @@ public:
             step->sample(ctx);
             return true;
         }
+
+        const char * trace_name() const final
+        { return "pS5 SampleJob"; }
+
+        size_t trace_size() const final
+        { return step->strptr.size(); }
     };
 
     struct CountJob : public job_type
@@ -1335,6 +1490,12 @@ public:
             step->count(p, ctx);
             return true;
         }
+
+        const char * trace_name() const final
+        { return "pS5 CountJob"; }
+
+        size_t trace_size() const final
+        { return step->psize; }
     };
 
     struct DistributeJob : public job_type
@@ -1352,13 +1513,20 @@ public:
             step->distribute(p, ctx);
             return true;
         }
+
+        const char * trace_name() const final
+        { return "pS5 DistributeJob"; }
+
+        size_t trace_size() const final
+        { return step->psize; }
     };
 
     // *** Constructor
 
     SampleSortStep(Context& ctx, SortStep* pstep,
-                   const StringPtr& strptr, size_t depth)
-        : pstep(pstep), strptr(strptr), depth(depth)
+                   const StringPtr& strptr, size_t depth, size_t limit)
+        : pstep(pstep), strptr(strptr), depth(depth),
+          limit(std::min(limit, strptr.size()))
     {
         parts = strptr.size() / ctx.sequential_threshold() * 2;
         if (parts == 0) parts = 1;
@@ -1421,10 +1589,12 @@ public:
         StrIterator strE = strset.begin() + std::min((p + 1) * psize, strptr.size());
         if (strE < strB) strE = strB;
 
-        uint16_t* mybktcache = bktcache[p] = new uint16_t[strE - strB];
+        uint16_t* mybktcache = bktcache[p] =
+            hugepage::allocate_array<uint16_t>(strE - strB);
         classifier.classify(strset, strB, strE, mybktcache, depth);
 
-        size_t* mybkt = bkt[p] = new size_t[bktnum + (p == 0 ? 1 : 0)];
+        size_t* mybkt = bkt[p] =
+            hugepage::allocate_array<size_t>(bktnum + (p == 0 ? 1 : 0));
         memset(mybkt, 0, bktnum * sizeof(size_t));
 
         for (uint16_t* bc = mybktcache; bc != mybktcache + (strE - strB); ++bc)
@@ -1477,13 +1647,22 @@ public:
         uint16_t* mybktcache = bktcache[p];
         size_t* mybkt = bkt[p];
 
-        for (StrIterator str = strB; str != strE; ++str, ++mybktcache)
-            *(sbegin + --mybkt[*mybktcache]) = std::move(*str);
+        if (!Context::Stable) {
+            for (StrIterator str = strB; str != strE; ++str, ++mybktcache)
+                *(sbegin + --mybkt[*mybktcache]) = std::move(*str);
+        }
+        else {
+            // fill buckets backwards, parts are laid out in order by the
+            // prefix sum, hence equal strings keep their input order.
+            mybktcache += strE - strB;
+            for (StrIterator str = strE; str != strB; )
+                *(sbegin + --mybkt[*--mybktcache]) = std::move(*--str);
+        }
 
         if (p != 0) // p = 0 is needed for recursion into bkts
-            delete[] bkt[p];
+            hugepage::deallocate(bkt[p]);
 
-        delete[] bktcache[p];
+        hugepage::deallocate(bktcache[p]);
 
         if (--pwork == 0)
             distribute_finished(ctx);
@@ -1494,7 +1673,7 @@ public:
         LOGC(debug_jobs)
             << "Finishing DistributeJob " << this << " with enqueuing subjobs";
 
-        size_t thrid = PS5_ENABLE_RESTSIZE ? omp_get_thread_num() : 0;
+        size_t thrid = PS5_ENABLE_RESTSIZE ? ThreadPool::thread_num() : 0;
 
         size_t* bkt = this->bkt[0];
         assert(bkt);
@@ -1503,6 +1682,9 @@ public:
         assert(bkt[0] == 0);
         bkt[bktnum] = strptr.size();
 
+        // partial sort: leave buckets beyond the limit unsorted
+        ctx.donesize(cut_buckets_at_limit<bktnum>(strptr, bkt, limit), thrid);
+
         // keep anonymous subjob handle while creating subjobs
         this->substep_add();
 
@@ -1525,7 +1707,8 @@ public:
                     << int(splitter_lcp[i / 2] & 0x7F);
                 this->substep_add();
                 Enqueue<Classify>(ctx, this, strptr.flip(bkt[i], bktsize),
-                                  depth + (splitter_lcp[i / 2] & 0x7F));
+                                  depth + (splitter_lcp[i / 2] & 0x7F),
+                                  limit - bkt[i]);
             }
             ++i;
             // i is odd -> bkt[i] is equal bucket
@@ -1544,7 +1727,8 @@ public:
                         << "Recurse[" << depth << "]: = bkt " << bkt[i]
                         << " size " << bktsize << " is done!";
                     StringPtr sp = strptr.flip(bkt[i], bktsize).copy_back();
-                    sp.fill_lcp(depth + lcpKeyDepth(classifier.get_splitter(i / 2)));
+                    finish_zero_bucket(
+                        sp, depth + lcpKeyDepth(classifier.get_splitter(i / 2)));
                     ctx.donesize(bktsize, thrid);
                 }
                 else {
@@ -1553,7 +1737,7 @@ public:
                         << " size " << bktsize << " lcp keydepth!";
                     this->substep_add();
                     Enqueue<Classify>(ctx, this, strptr.flip(bkt[i], bktsize),
-                                      depth + sizeof(key_type));
+                                      depth + sizeof(key_type), limit - bkt[i]);
                 }
             }
             ++i;
@@ -1573,13 +1757,14 @@ public:
                 << "Recurse[" << depth << "]: > bkt " << bkt[i]
                 << " size " << bktsize << " no lcp";
             this->substep_add();
-            Enqueue<Classify>(ctx, this, strptr.flip(bkt[i], bktsize), depth);
+            Enqueue<Classify>(ctx, this, strptr.flip(bkt[i], bktsize), depth,
+                              limit - bkt[i]);
         }
 
         this->substep_notify_done(); // release anonymous subjob handle
 
         if (!Context::CalcLcp) {
-            delete[] bkt;
+            hugepage::deallocate(bkt);
         }
     }
 
@@ -1592,7 +1777,7 @@ public:
                 << "pSampleSortStep[" << depth << "]: all substeps done.";
 
             sample_sort_lcp<bktnum>(classifier, strptr.original(), depth, bkt[0]);
-            delete[] bkt[0];
+            hugepage::deallocate(bkt[0]);
         }
 
         if (pstep) pstep->substep_notify_done();
@@ -1612,23 +1797,23 @@ public:
 
 template <template <size_t> class Classify, typename Context, typename StringPtr>
 void Enqueue(Context& ctx, SortStep* pstep,
-             const StringPtr& strptr, size_t depth)
+             const StringPtr& strptr, size_t depth, size_t limit)
 {
     if (enable_parallel_sample_sort &&
         (strptr.size() > ctx.sequential_threshold() || use_only_first_sortstep)) {
         new SampleSortStep<Context, Classify, StringPtr>(
-            ctx, pstep, strptr, depth);
+            ctx, pstep, strptr, depth, limit);
     }
     else {
         if (strptr.size() < ((uint64_t)1 << 32)) {
             ctx.jobqueue.enqueue(
                 new SmallsortJob<Context, Classify, StringPtr, uint32_t>(
-                    pstep, strptr, depth));
+                    pstep, strptr, depth, limit));
         }
         else {
             ctx.jobqueue.enqueue(
                 new SmallsortJob<Context, Classify, StringPtr, uint64_t>(
-                    pstep, strptr, depth));
+                    pstep, strptr, depth, limit));
         }
     }
 }
@@ -1637,12 +1822,15 @@ void Enqueue(Context& ctx, SortStep* pstep,
 // Externally Callable Sorting Methods
 
 //! Main Parallel Sample Sort Function. See below for more convenient wrappers.
+//! If limit is given, only the first limit positions are sorted.
 template <template <size_t> class Classify =
               bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+          bool Stable = false,
           typename StringPtr>
-void parallel_sample_sort(const StringPtr& strptr, size_t depth)
+void parallel_sample_sort(const StringPtr& strptr, size_t depth,
+                          size_t limit = size_t(-1))
 {
-    using SContext = Context<StringPtr::with_lcp>;
+    using SContext = Context<StringPtr::with_lcp, DefaultJobQueueGroup, Stable>;
     SContext ctx;
     ctx.totalsize = strptr.size();
 #if PS5_ENABLE_RESTSIZE
@@ -1654,9 +1842,12 @@ void parallel_sample_sort(const StringPtr& strptr, size_t depth)
 
     ctx.timers.start(ctx.threadnum);
 
-    Enqueue<Classify>(ctx, NULL, strptr, depth);
+    Enqueue<Classify>(ctx, NULL, strptr, depth, limit);
     ctx.jobqueue.loop();
 
+    // LCPs of binary strings were calculated from zero padded keys
+    clamp_padded_lcp(strptr);
+
     ctx.timers.stop();
 
 #if PS5_ENABLE_RESTSIZE
@@ -1684,6 +1875,7 @@ void parallel_sample_sort(const StringPtr& strptr, size_t depth)
 //! flipping.
 template <template <size_t> class Classify =
               bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+          bool Stable = false,
           typename StringSet>
 void parallel_sample_sort_base(const StringSet& strset, size_t depth)
 {
@@ -1694,7 +1886,7 @@ void parallel_sample_sort_base(const StringSet& strset, size_t depth)
     Container shadow = strset.allocate(strset.size());
     StringShadowPtr strptr(strset, StringSet(shadow));
 
-    parallel_sample_sort<Classify>(strptr, depth);
+    parallel_sample_sort<Classify, Stable>(strptr, depth);
 
     StringSet::deallocate(shadow);
 }
@@ -1730,7 +1922,8 @@ void parallel_sample_sort_out_test(const StringSet& strset, size_t depth)
 
 /******************************************************************************/
 
-template <template <size_t> class Classify, typename StringSet>
+template <template <size_t> class Classify, bool Stable = false,
+          typename StringSet>
 void parallel_sample_sort_lcp_base(
     const StringSet& strset, uintptr_t* lcp, size_t depth)
 {
@@ -1742,18 +1935,20 @@ void parallel_sample_sort_lcp_base(
 
     StringShadowLcpPtr strptr(strset, StringSet(shadow), lcp);
 
-    parallel_sample_sort<Classify>(strptr, depth);
+    parallel_sample_sort<Classify, Stable>(strptr, depth);
 
     StringSet::deallocate(shadow);
 }
 
 template <template <size_t> class Classify =
               bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+          bool Stable = false,
           typename StringSet>
 void parallel_sample_sort_lcp_base(const StringSet& strset, size_t depth)
 {
     std::vector<uintptr_t> tmp_lcp(strset.size());
-    parallel_sample_sort_lcp_base<Classify>(strset, tmp_lcp.data(), depth);
+    parallel_sample_sort_lcp_base<Classify, Stable>(
+        strset, tmp_lcp.data(), depth);
 }
 
 template <template <size_t> class Classify =
@@ -1794,6 +1989,163 @@ void parallel_sample_sort_out_lcp_verify(const StringSet& strset, size_t depth)
     StringSet::deallocate(out);
 }
 
+//! Stable Sample Sort on a generic StringSet: equal strings keep their order.
+template <typename StringSet>
+void parallel_sample_sort_stable(const StringSet& strset, size_t depth)
+{
+    parallel_sample_sort_base<
+        bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+        /* Stable */ true>(strset, depth);
+}
+
+//! Stable Sample Sort with LCP output, verify and discard the LCPs.
+template <typename StringSet>
+void parallel_sample_sort_stable_lcp_verify(
+    const StringSet& strset, size_t depth)
+{
+    std::vector<uintptr_t> tmp_lcp(strset.size());
+    tmp_lcp[0] = 42;                 // must keep lcp[0] unchanged
+    std::fill(tmp_lcp.begin() + 1, tmp_lcp.end(), -1);
+    parallel_sample_sort_lcp_base<
+        bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+        /* Stable */ true>(strset, tmp_lcp.data(), depth);
+    die_unless(stringtools::verify_lcp(strset, tmp_lcp.data(), 42));
+}
+
+/*!
+ * Partial Sample Sort on a generic StringSet: afterwards the first k positions
+ * contain the k smallest strings in order, the other strings follow in
+ * unspecified order. Only buckets overlapping the first k positions are sorted
+ * further, all others are left as distributed.
+ */
+template <template <size_t> class Classify =
+              bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+          bool Stable = false,
+          typename StringSet>
+void parallel_sample_sort_partial(
+    const StringSet& strset, size_t k, size_t depth)
+{
+    typedef stringtools::StringShadowPtr<StringSet> StringShadowPtr;
+    typedef typename StringSet::Container Container;
+
+    if (k == 0) return;
+
+    // allocate shadow pointer array
+    Container shadow = strset.allocate(strset.size());
+    StringShadowPtr strptr(strset, StringSet(shadow));
+
+    parallel_sample_sort<Classify, Stable>(strptr, depth, k);
+
+    StringSet::deallocate(shadow);
+}
+
+//! Partial Sample Sort of the first third of the strings, then sort the rest
+//! separately, which must yield a completely sorted StringSet.
+template <typename StringSet>
+void parallel_sample_sort_partial_test(const StringSet& strset, size_t depth)
+{
+    size_t k = strset.size() / 3 + 1;
+    parallel_sample_sort_partial(strset, k, depth);
+    if (k < strset.size())
+        parallel_sample_sort_base(strset.subi(k, strset.size()), depth);
+}
+
+/*!
+ * Sort and deduplicate null-terminated strings. The strings are sorted with
+ * LCP and character cache output into a separate array, in which a string is
+ * equal to its predecessor exactly if its cached character is zero, as the LCP
+ * then reaches the end of both strings. Copying back to strset collapses each
+ * run of equal strings into its first string, without reading any characters.
+ *
+ * Afterwards the first m positions of strset hold the distinct strings in
+ * order and counts[i] their multiplicities, the other positions are left in
+ * unspecified state; returns m. counts must have room for strset.size()
+ * entries. If given, lcp and cache receive the LCPs and cached characters of
+ * the distinct strings, lcp[0] and cache[0] are left unchanged.
+ */
+template <template <size_t> class Classify =
+              bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX,
+          bool Stable = false,
+          typename StringSet>
+size_t parallel_sample_sort_unique(
+    const StringSet& strset, size_t* counts, uintptr_t* lcp,
+    typename StringSet::Char* cache, size_t depth)
+{
+    typedef stringtools::StringShadowLcpCacheOutPtr<StringSet> StringOutPtr;
+    typedef typename StringSet::Char Char;
+    typedef typename StringSet::Iterator Iterator;
+
+    size_t n = strset.size();
+    if (n == 0) return 0;
+
+    typename StringSet::Container out = strset.allocate(n);
+    StringSet output(out);
+
+    std::vector<uintptr_t> tmp_lcp(n);
+    std::vector<Char> tmp_cache(n);
+
+    StringOutPtr strptr(strset, output, output, tmp_lcp.data(), tmp_cache.data());
+    parallel_sample_sort<Classify, Stable>(strptr, depth);
+
+    // number of distinct strings before each part, and in total
+    std::vector<size_t> unique(omp_get_max_threads() + 1, 0);
+    size_t total = 0;
+
+#pragma omp parallel
+    {
+        size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+        size_t begin = n * t / nthr, end = n * (t + 1) / nthr;
+
+        // count first strings of runs in this part
+        size_t m = 0;
+        for (size_t i = begin; i < end; ++i)
+            m += (i == 0 || tmp_cache[i] != 0);
+        unique[t + 1] = m;
+
+#pragma omp barrier
+#pragma omp single
+        {
+            std::partial_sum(unique.begin(), unique.begin() + nthr + 1,
+                             unique.begin());
+            total = unique[nthr];
+        }
+
+        // move first strings of runs back, runs may extend into the next part
+        size_t j = unique[t];
+        Iterator dst = strset.begin() + j;
+        Iterator src = output.begin();
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (i != 0 && tmp_cache[i] == 0) continue;
+
+            size_t r = i + 1;
+            while (r < n && tmp_cache[r] == 0) ++r;
+
+            *dst++ = std::move(*(src + i));
+            counts[j] = r - i;
+
+            if (j != 0) {
+                if (lcp) lcp[j] = tmp_lcp[i];
+                if (cache) cache[j] = tmp_cache[i];
+            }
+            ++j;
+        }
+    }
+
+    StringSet::deallocate(out);
+
+    return total;
+}
+
+//! Sort and deduplicate null-terminated strings, see above.
+template <typename StringSet>
+size_t parallel_sample_sort_unique(
+    const StringSet& strset, size_t* counts, size_t depth)
+{
+    return parallel_sample_sort_unique(strset, counts, NULL, NULL, depth);
+}
+
 //! Call for NUMA aware parallel sorting
 static inline
 void parallel_sample_sort_numa(string* strings, size_t n,
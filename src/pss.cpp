@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * src/pss.cpp
+ *
+ * Public library interface of parallel-string-sorting, see pss.hpp.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "pss.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "parallel/bingmann-parallel_sample_sort.hpp"
+#include "parallel/bingmann-parallel_mkqs.hpp"
+#include "tools/threadpool.hpp"
+#include "tools/globals.hpp"
+
+namespace pss {
+
+/******************************************************************************/
+// executor
+
+executor::executor(size_t num_threads, bool pin)
+{
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+
+    m_pool = new ThreadPool(num_threads, pin);
+}
+
+executor::~executor()
+{
+    delete m_pool;
+}
+
+size_t executor::num_threads() const
+{
+    return m_pool->size();
+}
+
+/******************************************************************************/
+// sort
+
+//! serializes calls, as the algorithms write into g_stats
+static std::mutex s_sort_mutex;
+
+//! run pS5 with optional LCP and character cache output, sort only the first k
+//! strings without LCPs, or deduplicate if counts is given.
+template <bool Stable, typename StringSet>
+static void sort_pS5(const StringSet& strset, size_t k,
+                     size_t* counts, size_t* num_unique, const options& opt)
+{
+    using namespace bingmann_parallel_sample_sort;
+    using bingmann_sample_sort::ClassifyTreeCalcUnrollInterleaveX;
+
+    if (counts)
+    {
+        *num_unique =
+            parallel_sample_sort_unique<ClassifyTreeCalcUnrollInterleaveX, Stable>(
+                strset, counts, opt.lcp, opt.charcache, 0);
+
+        // fixup first entry of LCP and charcache
+        if (opt.lcp) opt.lcp[0] = 0;
+        if (opt.charcache)
+            opt.charcache[0] = strset.get_char(strset[strset.begin()], 0);
+    }
+    else if (k < strset.size())
+    {
+        parallel_sample_sort_partial<ClassifyTreeCalcUnrollInterleaveX, Stable>(
+            strset, k, 0);
+    }
+    else if (!opt.lcp)
+    {
+        parallel_sample_sort_base<ClassifyTreeCalcUnrollInterleaveX, Stable>(
+            strset, 0);
+    }
+    else if (!opt.charcache)
+    {
+        parallel_sample_sort_lcp_base<ClassifyTreeCalcUnrollInterleaveX, Stable>(
+            strset, opt.lcp, 0);
+        opt.lcp[0] = 0;
+    }
+    else
+    {
+        // sort into output array, which is also the shadow array
+        typename StringSet::Container out = strset.allocate(strset.size());
+        StringSet output(out);
+
+        stringtools::StringShadowLcpCacheOutPtr<StringSet> strptr(
+            strset, output, output, opt.lcp, opt.charcache);
+
+        parallel_sample_sort<ClassifyTreeCalcUnrollInterleaveX, Stable>(
+            strptr, 0);
+
+        std::copy(output.begin(), output.end(), strset.begin());
+        StringSet::deallocate(out);
+
+        // fixup first entry of LCP and charcache
+        opt.lcp[0] = 0;
+        opt.charcache[0] = strset.get_char(strset[strset.begin()], 0);
+    }
+}
+
+//! check options, set up threads and executor, and run the selected algorithm
+//! to sort the first k strings, or to deduplicate them if counts is given.
+template <typename StringSet>
+static bool sort_generic(const StringSet& strset, size_t k,
+                         size_t* counts, size_t* num_unique,
+                         const options& opt)
+{
+    if (opt.charcache && !opt.lcp) return false;
+    if (opt.algo == parallel_mkqs && (opt.lcp || opt.stable)) return false;
+    if (k < strset.size() && (opt.algo != pS5 || opt.lcp)) return false;
+    if (counts && opt.algo != pS5) return false;
+
+    if (strset.size() <= 1 || k == 0)
+    {
+        if (counts) {
+            if (strset.size() == 1) counts[0] = 1;
+            *num_unique = strset.size();
+        }
+        if (strset.size() == 1) {
+            if (opt.lcp) opt.lcp[0] = 0;
+            if (opt.charcache)
+                opt.charcache[0] = strset.get_char(strset[strset.begin()], 0);
+        }
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(s_sort_mutex);
+
+    // select number of threads and bind the executor's pool to this thread
+    size_t num_threads = opt.num_threads;
+    if (num_threads == 0)
+        num_threads = opt.exec ? opt.exec->num_threads() : omp_get_num_procs();
+
+    int prev_threads = omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+
+    ThreadPool* prev_pool = ThreadPool::bound();
+    ThreadPool::bound() = opt.exec ? opt.exec->pool() : NULL;
+
+    if (opt.algo == pS5 && opt.stable)
+        sort_pS5</* Stable */ true>(strset, k, counts, num_unique, opt);
+    else if (opt.algo == pS5)
+        sort_pS5</* Stable */ false>(strset, k, counts, num_unique, opt);
+    else
+        bingmann_parallel_mkqs::bingmann_parallel_mkqs(strset, 0);
+
+    ThreadPool::bound() = prev_pool;
+    omp_set_num_threads(prev_threads);
+
+    // drop statistics, nobody outputs them
+    g_stats.clear();
+
+    return true;
+}
+
+bool sort(const UCharStringSet& strset, const options& opt)
+{
+    return sort_generic(strset, strset.size(), NULL, NULL, opt);
+}
+
+bool sort(const UCharPayloadStringSet& strset, const options& opt)
+{
+    return sort_generic(strset, strset.size(), NULL, NULL, opt);
+}
+
+bool sort(string* strings, size_t n, const options& opt)
+{
+    return sort(UCharStringSet(strings, strings + n), opt);
+}
+
+bool sort(string_payload* strings, size_t n, const options& opt)
+{
+    return sort(UCharPayloadStringSet(strings, strings + n), opt);
+}
+
+/******************************************************************************/
+// partial_sort
+
+bool partial_sort(const UCharStringSet& strset, size_t k, const options& opt)
+{
+    return sort_generic(strset, std::min(k, strset.size()), NULL, NULL, opt);
+}
+
+bool partial_sort(const UCharPayloadStringSet& strset, size_t k,
+                  const options& opt)
+{
+    return sort_generic(strset, std::min(k, strset.size()), NULL, NULL, opt);
+}
+
+bool partial_sort(string* strings, size_t n, size_t k, const options& opt)
+{
+    return partial_sort(UCharStringSet(strings, strings + n), k, opt);
+}
+
+bool partial_sort(string_payload* strings, size_t n, size_t k,
+                  const options& opt)
+{
+    return partial_sort(UCharPayloadStringSet(strings, strings + n), k, opt);
+}
+
+/******************************************************************************/
+// sort_unique
+
+bool sort_unique(const UCharStringSet& strset, size_t* counts,
+                 size_t* num_unique, const options& opt)
+{
+    return sort_generic(strset, strset.size(), counts, num_unique, opt);
+}
+
+bool sort_unique(const UCharPayloadStringSet& strset, size_t* counts,
+                 size_t* num_unique, const options& opt)
+{
+    return sort_generic(strset, strset.size(), counts, num_unique, opt);
+}
+
+bool sort_unique(string* strings, size_t n, size_t* counts,
+                 size_t* num_unique, const options& opt)
+{
+    return sort_unique(
+        UCharStringSet(strings, strings + n), counts, num_unique, opt);
+}
+
+bool sort_unique(string_payload* strings, size_t n, size_t* counts,
+                 size_t* num_unique, const options& opt)
+{
+    return sort_unique(
+        UCharPayloadStringSet(strings, strings + n), counts, num_unique, opt);
+}
+
+} // namespace pss
+
+/******************************************************************************/
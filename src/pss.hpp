@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * src/pss.hpp
+ *
+ * Public library interface of parallel-string-sorting: sort arrays of
+ * null-terminated strings with pS5 or parallel multikey quicksort, without
+ * setting up any of the psstest globals.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_PSS_HEADER
+#define PSS_SRC_PSS_HEADER
+
+#include <cstddef>
+#include <stdint.h>
+
+class ThreadPool;
+
+namespace parallel_string_sorting {
+
+template <typename CharType>
+class GenericCharStringSet;
+
+typedef GenericCharStringSet<unsigned char> UCharStringSet;
+
+template <typename CharType, typename PayloadType>
+struct StringPayload;
+
+template <typename CharType, typename PayloadType>
+class GenericCharPayloadStringSet;
+
+typedef GenericCharPayloadStringSet<unsigned char, uint64_t>
+    UCharPayloadStringSet;
+
+} // namespace parallel_string_sorting
+
+namespace pss {
+
+//! zero-terminated character strings
+typedef unsigned char* string;
+
+//! type of LCP array entries
+typedef uintptr_t lcp_t;
+
+//! string set of unsigned char* strings, see src/tools/stringset.hpp
+typedef parallel_string_sorting::UCharStringSet UCharStringSet;
+
+//! zero-terminated character string (member str) with a 64-bit payload
+//! (member payload, e.g. a record id) stored in the same array entry.
+typedef parallel_string_sorting::StringPayload<unsigned char, uint64_t>
+    string_payload;
+
+//! string set of string_payload entries, see src/tools/stringset.hpp
+typedef parallel_string_sorting::UCharPayloadStringSet UCharPayloadStringSet;
+
+//! sorting algorithms available via the library interface
+enum algorithm {
+    //! Parallel Super Scalar String Sample Sort, can output LCP and
+    //! distinguishing character cache.
+    pS5,
+    //! parallel multikey quicksort with 8-byte cache, outputs only strings.
+    parallel_mkqs
+};
+
+/*!
+ * Executor of parallel sorts: a set of long-lived worker threads, pinned to
+ * cores, which run the parallel regions of all sorts it is passed to. Sorts
+ * without an executor start a new OpenMP team each time.
+ */
+class executor
+{
+public:
+    //! create executor with num_threads threads (0 = all cores), including
+    //! the thread calling pss::sort().
+    explicit executor(size_t num_threads = 0, bool pin = true);
+
+    //! stop all worker threads
+    ~executor();
+
+    //! number of threads, including the caller
+    size_t num_threads() const;
+
+    //! underlying thread pool
+    ThreadPool* pool() const { return m_pool; }
+
+private:
+    //! the worker threads
+    ThreadPool* m_pool;
+
+    //! non-copyable
+    executor(const executor&) = delete;
+    executor& operator = (const executor&) = delete;
+};
+
+//! options of pss::sort()
+struct options
+{
+    //! algorithm to run
+    algorithm algo;
+
+    //! number of threads, 0 = all threads of the executor or all cores
+    size_t num_threads;
+
+    //! optional output array of n LCPs: lcp[i] = lcp(s[i-1],s[i]), lcp[0] = 0
+    lcp_t* lcp;
+
+    //! optional output array of n cached characters: charcache[i] =
+    //! s[i][lcp[i]], requires lcp.
+    unsigned char* charcache;
+
+    //! optional executor to run on
+    executor* exec;
+
+    //! keep the input order of equal strings, only supported by pS5.
+    bool stable;
+
+    options()
+        : algo(pS5), num_threads(0), lcp(NULL), charcache(NULL), exec(NULL),
+          stable(false)
+    { }
+};
+
+/*!
+ * Sort the strings of the string set in-place. Returns false without sorting
+ * if the options request output the algorithm cannot produce (LCP, character
+ * cache or stable order from parallel_mkqs, character cache without LCP).
+ *
+ * The algorithms report statistics into a library global, hence concurrent
+ * calls are serialized.
+ */
+bool sort(const UCharStringSet& strset, const options& opt = options());
+
+//! Sort the n strings of the array in-place, see above.
+bool sort(string* strings, size_t n, const options& opt = options());
+
+/*!
+ * Sort strings carrying a payload in-place, see above. The payloads are moved
+ * together with their strings, hence afterwards they are in the sorted order.
+ */
+bool sort(const UCharPayloadStringSet& strset,
+          const options& opt = options());
+
+//! Sort the n strings with payload of the array in-place, see above.
+bool sort(string_payload* strings, size_t n, const options& opt = options());
+
+/*!
+ * Partially sort the string set in-place: afterwards the first k positions
+ * contain the k smallest strings in sorted order, the remaining strings follow
+ * in unspecified order. Only buckets of pS5 overlapping the first k positions
+ * are sorted further, hence for small k the cost is close to a single
+ * distribution pass. Returns false without sorting if the options request LCP
+ * output or parallel_mkqs; stable order is supported.
+ */
+bool partial_sort(const UCharStringSet& strset, size_t k,
+                  const options& opt = options());
+
+//! Partially sort the n strings of the array in-place, see above.
+bool partial_sort(string* strings, size_t n, size_t k,
+                  const options& opt = options());
+
+//! Partially sort strings carrying a payload in-place, see above.
+bool partial_sort(const UCharPayloadStringSet& strset, size_t k,
+                  const options& opt = options());
+
+//! Partially sort the n strings with payload of the array in-place, see above.
+bool partial_sort(string_payload* strings, size_t n, size_t k,
+                  const options& opt = options());
+
+/*!
+ * Sort the strings in-place and collapse each run of equal strings into one:
+ * afterwards the first *num_unique positions hold the distinct strings in
+ * sorted order, counts[i] is the number of copies of string i, and the other
+ * positions are left in unspecified state. counts must have room for n
+ * entries, LCP and character cache output refer to the distinct strings. Only
+ * pS5 supports deduplication, with stable order the first copy in input order
+ * is kept. Returns false without sorting for unsupported options.
+ */
+bool sort_unique(const UCharStringSet& strset, size_t* counts,
+                 size_t* num_unique, const options& opt = options());
+
+//! Sort and deduplicate the n strings of the array in-place, see above.
+bool sort_unique(string* strings, size_t n, size_t* counts,
+                 size_t* num_unique, const options& opt = options());
+
+//! Sort and deduplicate strings carrying a payload in-place, see above. The
+//! payload of the kept copy remains with the string.
+bool sort_unique(const UCharPayloadStringSet& strset, size_t* counts,
+                 size_t* num_unique, const options& opt = options());
+
+//! Sort and deduplicate the n strings with payload of the array, see above.
+bool sort_unique(string_payload* strings, size_t n, size_t* counts,
+                 size_t* num_unique, const options& opt = options());
+
+} // namespace pss
+
+#endif // !PSS_SRC_PSS_HEADER
+
+/******************************************************************************/
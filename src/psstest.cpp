@@ -47,7 +47,6 @@
 
 #include <omp.h>
 #include <getopt.h>
-#include <gmpxx.h>
 #include <numa.h>
 
 #include <boost/static_assert.hpp>
@@ -100,9 +99,16 @@ bool gopt_threads = false;           // argument --threads
 bool gopt_all_threads = false;       // argument --all-threads
 bool gopt_some_threads = false;      // argument --some-threads
 bool gopt_no_check = false;          // argument --no-check
+bool gopt_check_stable = false;      // argument --check-stable
 bool gopt_mlockall = false;          // argument --mlockall
 bool gopt_segment_threads = false;   // argument --segment-threads
 bool gopt_segment_one_thread = false; // argument --segment-1thread
+bool gopt_thread_pool = false;       // argument --thread-pool
+bool gopt_perf = false;              // argument --perf
+const char* gopt_trace = NULL;       // argument --trace
+const char* gopt_bench = NULL;       // argument --bench
+double gopt_bench_ci = 2.0;          // argument --bench-ci, in percent
+size_t gopt_bench_max = 30;          // argument --bench-max
 
 std::vector<size_t> gopt_threadlist; // argument --thread-list
 
@@ -114,6 +120,10 @@ bool gopt_forkdataload = false;
 bool gopt_sequential_only = false;            // argument --sequential
 bool gopt_parallel_only = false;              // argument --parallel
 
+size_t gopt_external_runsize = 0;             // argument --external
+size_t gopt_external_blocksize = 4 * 1024 * 1024; // argument --external-block
+const char* gopt_external_tmpdir = "/tmp";    // argument --external-tmpdir
+
 const size_t g_stacklimit = 64 * 1024 * 1024; // increase from 8 MiB
 
 // for -M mmap_segment:
@@ -129,6 +139,10 @@ std::vector<size_t> g_numa_string_count;      // pointer to strings on NUMA node
 #include "tools/input.hpp"
 #include "tools/checker.hpp"
 #include "tools/stringtools.hpp"
+#include "tools/threadpool.hpp"
+#include "tools/perf_counters.hpp"
+#include "tools/job_trace.hpp"
+#include "tools/bench_summary.hpp"
 
 #include "sequential/inssort.hpp"
 #include "sequential/bs-mkqs.hpp"
@@ -141,6 +155,7 @@ std::vector<size_t> g_numa_string_count;      // pointer to strings on NUMA node
 
 #include "parallel/eberle-ps5-parallel-toplevel-merge.hpp"
 #include "parallel/eberle-parallel-lcp-mergesort.hpp"
+#include "parallel/bingmann-external_sort.hpp"
 
 #include "rantala/tools/debug.hpp"
 #include "rantala/tools/get_char.hpp"
@@ -168,6 +183,9 @@ Contest * getContestSingleton()
     return c;
 }
 
+// summary of benchmark mode, enabled by --bench
+BenchSummary* g_bench = NULL;
+
 static inline bool gopt_algorithm_select(const Contestant* c)
 {
     if (gopt_sequential_only && c->is_parallel()) return false;
@@ -386,7 +404,8 @@ void Contestant_UCArray::run_forked()
 
 void Contestant_UCArray::real_run(
     membuffer<uint8_t*>& stringptr,
-    std::vector<uintptr_t>& lcp, std::vector<uint8_t>& charcache)
+    std::vector<uintptr_t, hugepage::allocator<uintptr_t> >& lcp,
+    std::vector<uint8_t, hugepage::allocator<uint8_t> >& charcache)
 {
     if (!gopt_segment_threads && !gopt_segment_one_thread)
     {
@@ -408,13 +427,8 @@ void Contestant_UCArray::real_run(
         std::vector<std::pair<size_t, size_t> > ranges(nthr);
         stringtools::calculateRanges(ranges.data(), nthr, stringptr.size());
 
-        std::vector<std::thread> threads(nthr);
-        for (size_t i = 0; i < nthr; ++i) {
-            if (gopt_segment_one_thread && i != 0)
-                continue;
-
-            threads[i] = std::thread(
-                [this, &stringptr, &lcp, &charcache, &ranges, i]() {
+        auto segment =
+            [this, &stringptr, &lcp, &charcache, &ranges](size_t i) {
                 size_t begin, length;
                 std::tie(begin, length) = ranges[i];
 
@@ -430,14 +444,25 @@ void Contestant_UCArray::real_run(
                         charcache.data() + begin, length);
                 else
                     m_run_func(stringptr.data() + begin, length);
-            });
-        }
+            };
 
-        for (size_t i = 0; i < nthr; ++i) {
-            if (gopt_segment_one_thread && i != 0)
-                continue;
+        if (gopt_segment_one_thread)
+        {
+            std::thread(segment, 0).join();
+        }
+        else if (g_thread_pool)
+        {
+            g_thread_pool->run(
+                nthr, [&segment](size_t i, size_t) { segment(i); });
+        }
+        else
+        {
+            std::vector<std::thread> threads(nthr);
+            for (size_t i = 0; i < nthr; ++i)
+                threads[i] = std::thread(segment, i);
 
-            threads[i].join();
+            for (size_t i = 0; i < nthr; ++i)
+                threads[i].join();
         }
     }
 }
@@ -457,6 +482,9 @@ void Contestant_UCArray::prepare_run()
         std::cout << "Successfully locked process into memory." << std::endl;
     }
 
+    // count huge pages of string pointers and temporaries of this run
+    hugepage::reset_counters();
+
     // create unsigned char* array from offsets
     membuffer<string> stringptr(g_string_count);
 
@@ -476,7 +504,16 @@ void Contestant_UCArray::prepare_run()
     g_numa_strings.resize(numNumaNodes);
     g_numa_string_count.resize(numNumaNodes);
 
-    if (!gopt_suffixsort)
+    if (!gopt_suffixsort && g_numa_chars.size() == 2)
+    {
+        // single NUMA segment: find string starts with all threads
+        input::parallel_string_starts(stringptr.data());
+
+        std::fill(g_numa_strings.begin(), g_numa_strings.end(), 0);
+        std::fill(g_numa_string_count.begin(), g_numa_string_count.end(), 0);
+        g_numa_string_count[0] = g_string_count;
+    }
+    else if (!gopt_suffixsort)
     {
         size_t j = 0;
         for (size_t i = 0; i < g_string_datasize; ++i)
@@ -554,10 +591,35 @@ void Contestant_UCArray::prepare_run()
     if (g_smallsort)
         g_stats >> "smallsort" << g_smallsort;
 
+    if (gopt_work_stealing)
+        g_stats >> "work_stealing" << gopt_work_stealing;
+
     // enable nested parallel regions
     omp_set_nested(true);
     omp_set_num_threads(g_num_threads);
 
+    if (gopt_thread_pool)
+    {
+        // create the pool on first use, it is then reused by all following
+        // runs of this process. Threads do not survive fork(), hence with -F
+        // or -D each child creates its own.
+        if (!g_thread_pool)
+            g_thread_pool = new ThreadPool(std::thread::hardware_concurrency());
+
+        g_stats >> "thread_pool" << g_thread_pool->size();
+    }
+
+    if (gopt_trace)
+    {
+        // the trace collects the jobs of all runs of this process and is
+        // rewritten after each, hence with -F or -D it contains only the last.
+        if (!g_job_trace)
+            g_job_trace = new JobTrace;
+
+        g_job_trace->begin_run(
+            std::string(m_algoname) + " p=" + std::to_string(g_num_threads));
+    }
+
     if (g_num_threads)
     {
         // dummy parallel region to start up threads
@@ -575,7 +637,7 @@ void Contestant_UCArray::prepare_run()
     malloc_count_reset_peak();
 #endif
 
-    std::vector<uintptr_t> lcp;
+    std::vector<uintptr_t, hugepage::allocator<uintptr_t> > lcp;
     if (is_lcp_func() || is_lcp_cache_func()) {
         lcp.resize(g_string_count);
         // must keep lcp[0] unchanged
@@ -583,7 +645,7 @@ void Contestant_UCArray::prepare_run()
         std::fill(lcp.begin() + 1, lcp.end(), -1);
     }
 
-    std::vector<uint8_t> charcache;
+    std::vector<uint8_t, hugepage::allocator<uint8_t> > charcache;
     if (is_lcp_cache_func()) {
         charcache.resize(g_string_count);
         charcache[0] = 0;
@@ -593,12 +655,18 @@ void Contestant_UCArray::prepare_run()
     ClockIntervalBase<CLOCK_MONOTONIC> timer;
     ClockIntervalBase<CLOCK_PROCESS_CPUTIME_ID> cpu_timer;
 
+    // open hardware counters on all threads, which exist after the warm-up
+    PerfCounters perf;
+    bool perf_ok = gopt_perf && perf.open();
+
     if (gopt_repeats_inner == 1)
     {
         cpu_timer.start(), timer.start();
+        if (perf_ok) perf.start();
         {
             real_run(stringptr, lcp, charcache);
         }
+        if (perf_ok) perf.stop();
         timer.stop(), cpu_timer.stop();
     }
     else
@@ -608,6 +676,7 @@ void Contestant_UCArray::prepare_run()
         stringptr_copy.copy(stringptr_copy);
 
         cpu_timer.start(), timer.start();
+        if (perf_ok) perf.start();
 
         for (size_t rep = 0; rep < gopt_repeats_inner; ++rep)
         {
@@ -630,6 +699,7 @@ void Contestant_UCArray::prepare_run()
 
             real_run(stringptr, lcp, charcache);
         }
+        if (perf_ok) perf.stop();
         timer.stop(), cpu_timer.stop();
     }
 
@@ -656,16 +726,38 @@ void Contestant_UCArray::prepare_run()
     if (gopt_repeats_inner != 1)
         g_stats >> "repeats_inner" << gopt_repeats_inner;
 
+    if (perf_ok)
+        perf.put_stats(g_stats, gopt_repeats_inner);
+
+    if (g_hugepage_alloc)
+    {
+        g_stats >> "hugepage_data_pages"
+                << hugepage::count_pages(g_string_databuff, g_string_buffsize)
+            >> "hugepage_data_total" << g_string_buffsize / hugepage::page_size
+            >> "hugepage_alloc_hugetlb" << hugepage::counters().hugetlb_pages
+            >> "hugepage_alloc_thp" << hugepage::counters().thp_pages;
+    }
+
+    if (g_job_trace)
+    {
+        g_job_trace->write_json(gopt_trace);
+        if (g_job_trace->dropped())
+            g_stats >> "trace_dropped" << g_job_trace->dropped();
+    }
+
+    bool ok = true;
+
     if (!gopt_no_check)
     {
-        bool ok = check_sorted_order(stringptr, pc);
+        ok = check_sorted_order(stringptr, pc);
+        if (ok && gopt_check_stable) {
+            ok = check_stable_order(stringptr);
+        }
         if (ok && is_lcp_func()) {
-            ok = stringtools::verify_lcp(
-                stringptr.data(), lcp.data(), stringptr.size(), 42);
+            ok = check_lcp_cache(stringptr, lcp.data(), NULL, 42);
         }
         if (ok && is_lcp_cache_func()) {
-            ok = stringtools::verify_lcp_cache(
-                stringptr.data(), lcp.data(), charcache.data(), stringptr.size(), 42);
+            ok = check_lcp_cache(stringptr, lcp.data(), charcache.data(), 42);
         }
         if (ok) {
             std::cout << "ok" << std::endl;
@@ -689,6 +781,15 @@ void Contestant_UCArray::prepare_run()
         std::cout << "skipped" << std::endl;
     }
 
+    if (g_bench)
+    {
+        BenchSummary::Result& res = g_bench->result();
+        res.time = timer.delta() / gopt_repeats_inner;
+        res.string_count = stringptr.size();
+        res.char_count = g_string_datasize;
+        res.valid = ok;
+    }
+
     // print timing data out to results file
     std::cout << g_stats << std::endl;
     g_stats.clear();
@@ -704,13 +805,35 @@ void Contestant_UCArray::prepare_run()
     }
 }
 
+void Contestant_UCArray::run_repeated()
+{
+    // in benchmark mode, repeat until the confidence interval is reached
+    if (g_bench)
+        g_bench->begin(m_algoname, input::strip_datapath(g_datapath),
+                       g_num_threads);
+
+    for (size_t r = 0; g_bench ? g_bench->repeat() : r < gopt_repeats; ++r)
+    {
+        if (is_parallel())
+        {
+            g_stats.clear();
+            std::cout << "threads=" << g_num_threads << std::endl;
+            g_stats >> "threads" << g_num_threads;
+        }
+
+        run_forked();
+    }
+
+    if (g_bench)
+        g_bench->end();
+}
+
 void Contestant_UCArray::run()
 {
     // sequential algorithm
     g_num_threads = 0;
 
-    for (size_t r = 0; r < gopt_repeats; ++r)
-        run_forked();
+    run_repeated();
 }
 
 void Contestant_UCArray_Parallel::run()
@@ -719,17 +842,9 @@ void Contestant_UCArray_Parallel::run()
     {
         for (size_t pi = 0; pi < gopt_threadlist.size(); ++pi)
         {
-            size_t p = gopt_threadlist[pi];
-
-            for (size_t r = 0; r < gopt_repeats; ++r)
-            {
-                g_stats.clear();
-                g_num_threads = p;
-                std::cout << "threads=" << p << std::endl;
-                g_stats >> "threads" << p;
+            g_num_threads = gopt_threadlist[pi];
 
-                Contestant_UCArray::run_forked();
-            }
+            Contestant_UCArray::run_repeated();
         }
     }
     else
@@ -756,15 +871,9 @@ void Contestant_UCArray_Parallel::run()
 
         while (1)
         {
-            for (size_t r = 0; r < gopt_repeats; ++r)
-            {
-                g_stats.clear();
-                g_num_threads = p;
-                std::cout << "threads=" << p << std::endl;
-                g_stats >> "threads" << p;
+            g_num_threads = p;
 
-                Contestant_UCArray::run_forked();
-            }
+            Contestant_UCArray::run_repeated();
 
             if (p == nprocs) break;
 
@@ -804,8 +913,15 @@ void print_usage(const char* prog)
               << "  -a, --algo <match>     Run only algorithms containing this substring, can be used multile times. Try \"list\"." << std::endl
               << "  -A, --algoname <name>  Run only algorithms fully matching this string, can be used multile times. Try \"list\"." << std::endl
               << "      --all-threads      Run linear thread increase test from 1 to max_processors." << std::endl
+              << "      --bench <path>     Benchmark mode: repeat runs until --bench-ci is met, write summary as CSV or JSON (.json) to file." << std::endl
+              << "      --bench-ci <pct>   Relative 95% confidence interval of mean time to reach (default: 2)." << std::endl
+              << "      --bench-max <num>  Maximum number of runs per configuration (default: 30), -r gives the minimum." << std::endl
+              << "      --check-stable     Check that equal strings keep their input order." << std::endl
               << "  -D, --datafork         Fork before running algorithm and load data within fork!" << std::endl
               << "  -e, --exclude <name>   Skip algorithms containing name!" << std::endl
+              << "      --external <size>  Sort input files externally: pS5 runs of <size> bytes and LCP merge into -o." << std::endl
+              << "      --external-block <size> I/O block size for external runs (default: 4 MiB)." << std::endl
+              << "      --external-tmpdir <dir> Directory for external runs (default: /tmp)." << std::endl
               << "  -F, --fork             Fork before running algorithm, but load data before fork!" << std::endl
               << "  -i, --input <path>     Write unsorted input strings to file, usually for checking." << std::endl
               << "  -M, --memory <type>    Load string data into <type> memory, see -M list for details." << std::endl
@@ -814,6 +930,7 @@ void print_usage(const char* prog)
               << "      --numa-nodes <n>   Fake number of NUMA nodes on system." << std::endl
               << "  -o, --output <path>    Write sorted strings to output file, terminate after first algorithm run." << std::endl
               << "      --parallel         Run only parallelized algorithms." << std::endl
+              << "      --perf             Count cycles, instructions, LLC, dTLB and branch misses with perf_event_open." << std::endl
               << "  -r, --repeat <num>     Repeat experiment a number of times." << std::endl
               << "  -R, --repeat-inner <n> Repeat inner experiment loop a number of times and divide by repetition count." << std::endl
               << "  -s, --size <size>      Limit the input size to this number of characters." << std::endl
@@ -822,10 +939,14 @@ void print_usage(const char* prog)
               << "      --segment-1thread  Run sequential algorithms in parallel on segments of input." << std::endl
               << "      --sequential       Run only sequential algorithms." << std::endl
               << "      --some-threads     Run specific selected thread counts from 1 to max_processors." << std::endl
+              << "      --steal-remote-min <size> Steal only jobs of this many strings from other NUMA nodes (default: 64Ki)." << std::endl
               << "      --suffix           Suffix sort the input file." << std::endl
               << "  -T, --timeout <sec>    Abort algorithms after this timeout (default: disabled)." << std::endl
+              << "      --trace <path>     Write timeline of all JobQueue jobs as Chrome trace JSON to file." << std::endl
               << "      --threads          Run tests with doubling number of threads from 1 to max_processors." << std::endl
               << "      --thread-list <#>  Run tests with number of threads in list (comma or space separated)." << std::endl
+              << "      --thread-pool      Run parallel algorithms on a persistent pool of pinned threads." << std::endl
+              << "      --work-stealing    Use per-thread work-stealing deques in the JobQueue." << std::endl
     ;
 }
 
@@ -842,7 +963,19 @@ int main(int argc, char* argv[])
         OPT_SOME_THREADS,
         OPT_THREAD_LIST,
         OPT_MLOCKALL,
-        OPT_NUMA_NODES
+        OPT_NUMA_NODES,
+        OPT_WORK_STEALING,
+        OPT_STEAL_REMOTE_MIN,
+        OPT_THREAD_POOL,
+        OPT_PERF,
+        OPT_TRACE,
+        OPT_EXTERNAL,
+        OPT_EXTERNAL_BLOCK,
+        OPT_EXTERNAL_TMPDIR,
+        OPT_CHECK_STABLE,
+        OPT_BENCH,
+        OPT_BENCH_CI,
+        OPT_BENCH_MAX
     };
 
     static const struct option longopts[] = {
@@ -872,6 +1005,18 @@ int main(int argc, char* argv[])
         { "thread-list", required_argument, 0, OPT_THREAD_LIST },
         { "mlockall", no_argument, 0, OPT_MLOCKALL },
         { "numa-nodes", required_argument, 0, OPT_NUMA_NODES },
+        { "work-stealing", no_argument, 0, OPT_WORK_STEALING },
+        { "steal-remote-min", required_argument, 0, OPT_STEAL_REMOTE_MIN },
+        { "thread-pool", no_argument, 0, OPT_THREAD_POOL },
+        { "perf", no_argument, 0, OPT_PERF },
+        { "trace", required_argument, 0, OPT_TRACE },
+        { "external", required_argument, 0, OPT_EXTERNAL },
+        { "external-block", required_argument, 0, OPT_EXTERNAL_BLOCK },
+        { "external-tmpdir", required_argument, 0, OPT_EXTERNAL_TMPDIR },
+        { "check-stable", no_argument, 0, OPT_CHECK_STABLE },
+        { "bench", required_argument, 0, OPT_BENCH },
+        { "bench-ci", required_argument, 0, OPT_BENCH_CI },
+        { "bench-max", required_argument, 0, OPT_BENCH_MAX },
         { 0, 0, 0, 0 },
     };
 
@@ -961,6 +1106,7 @@ int main(int argc, char* argv[])
             gopt_memory_type = optarg;
             if (!input::check_memory_type(gopt_memory_type))
                 return 0;
+            g_hugepage_alloc = (gopt_memory_type == "mmap_huge");
             std::cout << "Option -M: loading input strings into \"" << gopt_memory_type << "\" memory" << std::endl;
             break;
 
@@ -1057,6 +1203,81 @@ int main(int argc, char* argv[])
             std::cout << "Option --numa-nodes: set number of (fake) NUMA nodes to " << g_numa_nodes << "." << std::endl;
             break;
 
+        case OPT_WORK_STEALING: // --work-stealing
+            gopt_work_stealing = true;
+            std::cout << "Option --work-stealing: using per-thread work-stealing deques in JobQueue." << std::endl;
+            break;
+
+        case OPT_STEAL_REMOTE_MIN: // --steal-remote-min <size>
+            if (!tlx::parse_si_iec_units(optarg, &g_steal_remote_minsize)) {
+                std::cout << "Option --steal-remote-min: invalid size parameter: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            std::cout << "Option --steal-remote-min: stealing jobs of at least " << g_steal_remote_minsize << " strings from other NUMA nodes." << std::endl;
+            break;
+
+        case OPT_THREAD_POOL: // --thread-pool
+            gopt_thread_pool = true;
+            std::cout << "Option --thread-pool: running parallel algorithms on a persistent thread pool." << std::endl;
+            break;
+
+        case OPT_PERF: // --perf
+            gopt_perf = true;
+            std::cout << "Option --perf: counting hardware events with perf_event_open." << std::endl;
+            break;
+
+        case OPT_CHECK_STABLE: // --check-stable
+            gopt_check_stable = true;
+            std::cout << "Option --check-stable: checking that equal strings keep their input order." << std::endl;
+            break;
+
+        case OPT_BENCH: // --bench <path>
+            gopt_bench = optarg;
+            std::cout << "Option --bench: writing benchmark summary to " << gopt_bench << std::endl;
+            break;
+
+        case OPT_BENCH_CI: // --bench-ci <percent>
+            gopt_bench_ci = atof(optarg);
+            if (gopt_bench_ci <= 0) {
+                std::cout << "Option --bench-ci: invalid confidence interval: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            std::cout << "Option --bench-ci: repeating until confidence interval is within " << gopt_bench_ci << "% of mean." << std::endl;
+            break;
+
+        case OPT_BENCH_MAX: // --bench-max <num>
+            gopt_bench_max = atoi(optarg);
+            std::cout << "Option --bench-max: running each configuration at most " << gopt_bench_max << " times." << std::endl;
+            break;
+
+        case OPT_TRACE: // --trace <path>
+            gopt_trace = optarg;
+            std::cout << "Option --trace: writing timeline of jobs to " << gopt_trace << std::endl;
+            break;
+
+        case OPT_EXTERNAL: // --external <size>
+            if (!tlx::parse_si_iec_units(optarg, &gopt_external_runsize) ||
+                gopt_external_runsize == 0) {
+                std::cout << "Option --external: invalid run size parameter: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            std::cout << "Option --external: sorting externally with runs of " << gopt_external_runsize << " bytes." << std::endl;
+            break;
+
+        case OPT_EXTERNAL_BLOCK: // --external-block <size>
+            if (!tlx::parse_si_iec_units(optarg, &gopt_external_blocksize) ||
+                gopt_external_blocksize == 0) {
+                std::cout << "Option --external-block: invalid block size parameter: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            std::cout << "Option --external-block: using I/O blocks of " << gopt_external_blocksize << " bytes." << std::endl;
+            break;
+
+        case OPT_EXTERNAL_TMPDIR: // --external-tmpdir <dir>
+            gopt_external_tmpdir = optarg;
+            std::cout << "Option --external-tmpdir: writing runs to " << gopt_external_tmpdir << std::endl;
+            break;
+
         case OPT_SEGMENT_THREADS: // --segment-threads
             gopt_segment_threads = gopt_no_check = true;
             std::cout << "Option --segment-threads: running sequential algorithms in parallel on segments of the input. This implies skipping checking." << std::endl;
@@ -1089,6 +1310,39 @@ int main(int argc, char* argv[])
 
     numa_set_strict(1);
 
+    if (gopt_bench)
+    {
+        g_bench = new BenchSummary(gopt_bench, gopt_bench_ci / 100.0,
+                                   gopt_repeats, gopt_bench_max);
+    }
+
+    if (gopt_external_runsize)
+    {
+        // sort input files externally instead of running the contest
+        for ( ; optind < argc; ++optind)
+        {
+            std::string path = argv[optind];
+            std::string output = gopt_output ? gopt_output : path + ".sorted";
+
+            std::cout << "Sorting " << path << " externally into " << output << std::endl;
+
+            bingmann_external_sort::ExternalSorter sorter(
+                gopt_external_runsize, gopt_external_blocksize,
+                gopt_external_tmpdir);
+
+            bool ok = sorter.sort_file(path, output);
+
+            g_stats >> "algo" << "bingmann/external_sort"
+                >> "data" << input::strip_datapath(path)
+                >> "status" << (ok ? "ok" : "failed");
+
+            std::cout << g_stats << std::endl;
+            g_stats.clear();
+        }
+
+        return 0;
+    }
+
     for ( ; optind < argc; ++optind)
     {
         // iterate over input size range
@@ -1107,6 +1361,10 @@ int main(int argc, char* argv[])
 
     input::free_stringdata();
 
+    delete g_thread_pool;
+    delete g_job_trace;
+    delete g_bench;
+
     return 0;
 }
 
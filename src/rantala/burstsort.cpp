@@ -47,6 +47,8 @@
 
 #include <boost/array.hpp>
 
+#include <omp.h>
+
 #include "tools/debug.hpp"
 #include "tools/get_char.hpp"
 #include "tools/vector_malloc.hpp"
@@ -55,6 +57,9 @@
 #include "tools/vector_bagwell.hpp"
 #include "tools/vector_brodnik.hpp"
 #include "../tools/contest.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/stringtools.hpp"
+#include "../tools/jobqueue.hpp"
 #include "../sequential/bs-mkqs.hpp"
 
 namespace rantala_burstsort {
@@ -224,12 +229,13 @@ finish:
 template <unsigned Threshold, typename BucketT,
           typename BurstImpl, typename CharT>
 static inline void
-insert(TrieNode<CharT>* root, unsigned char** strings, size_t n)
+insert(TrieNode<CharT>* root, unsigned char** strings, size_t n,
+       size_t root_depth = 0)
 {
 	for (size_t i=0; i < n; ++i) {
 		unsigned char* str = strings[i];
-		size_t depth = 0;
-		CharT c = get_char<CharT>(str, 0);
+		size_t depth = root_depth;
+		CharT c = get_char<CharT>(str, depth);
 		TrieNode<CharT>* node = root;
 		while (node->is_trie[c]) {
 			assert(not is_end(c));
@@ -469,6 +475,153 @@ void burstsort_sampling_superalphabet_vector_block(unsigned char** strings, size
 	traverse<BucketT>(root, strings, 0, SmallSort);
 }
 
+//
+// Parallel variants
+//
+
+// Burst trie of strings equal up to depth, built and traversed by one job.
+template <unsigned Threshold, typename BucketT, typename CharT>
+struct BurstJob final : public jobqueue::Job
+{
+	unsigned char** strings;
+	size_t n, depth;
+
+	BurstJob(jobqueue::JobQueue& job_queue, unsigned char** strings,
+	         size_t n, size_t depth)
+		: strings(strings), n(n), depth(depth)
+	{
+		job_queue.enqueue(this);
+	}
+
+	virtual bool run(jobqueue::JobQueue&)
+	{
+		TrieNode<CharT>* root = new TrieNode<CharT>;
+		insert<Threshold, BucketT, BurstSimple<CharT> >(
+				root, strings, n, depth);
+		traverse<BucketT>(root, strings, depth, SmallSort);
+		return true;
+	}
+
+	virtual const char* trace_name() const
+	{ return "Burstsort BurstJob"; }
+
+	virtual size_t trace_size() const
+	{ return n; }
+};
+
+// Distributes strings, which are equal up to depth, by their character at
+// depth. Each thread pushes its part of the strings into its own buckets, then
+// copies them back to precomputed positions, which needs no locks. Subtrees
+// larger than shard_size are distributed again, smaller ones are sorted by a
+// BurstJob. Returns the number of BurstJobs.
+template <unsigned Threshold, typename BucketT, typename CharT>
+static size_t
+parallel_distribute(jobqueue::JobQueue& job_queue, unsigned char** strings,
+                    size_t n, size_t depth, size_t shard_size)
+{
+	if (n <= shard_size) {
+		new BurstJob<Threshold, BucketT, CharT>(
+				job_queue, strings, n, depth);
+		return 1;
+	}
+	const size_t K = max<CharT>::value;
+	const size_t maxthr = omp_get_max_threads();
+	std::vector<BucketT*> buckets(maxthr*K, 0);
+	std::vector<size_t> offset(maxthr*K);
+	std::vector<size_t> bkt(K+1);
+#pragma omp parallel
+	{
+		const size_t nthr = omp_get_num_threads();
+		const size_t t = omp_get_thread_num();
+		BucketT** mybkt = buckets.data() + t*K;
+		for (size_t i=n*t/nthr; i < n*(t+1)/nthr; ++i) {
+			const CharT ch = get_char<CharT>(strings[i], depth);
+			if (not mybkt[ch]) mybkt[ch] = new BucketT;
+			mybkt[ch]->push_back(strings[i]);
+		}
+#pragma omp barrier
+#pragma omp single
+		{
+			size_t sum = 0;
+			for (size_t c=0; c < K; ++c) {
+				bkt[c] = sum;
+				for (size_t p=0; p < nthr; ++p) {
+					offset[p*K+c] = sum;
+					if (buckets[p*K+c])
+						sum += buckets[p*K+c]->size();
+				}
+			}
+			bkt[K] = sum;
+		}
+		for (size_t c=0; c < K; ++c) {
+			if (not mybkt[c]) continue;
+			copy(*mybkt[c], strings + offset[t*K+c]);
+			delete mybkt[c];
+		}
+	}
+	size_t jobs = 0;
+	for (size_t c=0; c < K; ++c) {
+		if (is_end(CharT(c)) or bkt[c+1]-bkt[c] <= 1) continue;
+		jobs += parallel_distribute<Threshold, BucketT, CharT>(
+				job_queue, strings+bkt[c], bkt[c+1]-bkt[c],
+				depth+sizeof(CharT), shard_size);
+	}
+	return jobs;
+}
+
+template <unsigned Threshold, typename BucketT, typename CharT>
+static void
+parallel_burstsort(unsigned char** strings, size_t n)
+{
+	jobqueue::JobQueue job_queue;
+	size_t jobs = parallel_distribute<Threshold, BucketT, CharT>(
+			job_queue, strings, n, 0,
+			std::max<size_t>(Threshold, n/omp_get_max_threads()));
+	job_queue.loop();
+	g_stats >> "burst_jobs" << jobs;
+}
+
+void parallel_burstsort_vector(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<8000, std::vector<unsigned char*>,
+		unsigned char>(strings, n);
+}
+void parallel_burstsort_brodnik(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<16000, vector_brodnik<unsigned char*>,
+		unsigned char>(strings, n);
+}
+void parallel_burstsort_bagwell(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<16000, vector_bagwell<unsigned char*>,
+		unsigned char>(strings, n);
+}
+void parallel_burstsort_vector_block(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<16000, vector_block<unsigned char*>,
+		unsigned char>(strings, n);
+}
+void parallel_burstsort_superalphabet_vector(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<32000, std::vector<unsigned char*>,
+		uint16_t>(strings, n);
+}
+void parallel_burstsort_superalphabet_brodnik(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<32000, vector_brodnik<unsigned char*>,
+		uint16_t>(strings, n);
+}
+void parallel_burstsort_superalphabet_bagwell(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<32000, vector_bagwell<unsigned char*>,
+		uint16_t>(strings, n);
+}
+void parallel_burstsort_superalphabet_vector_block(unsigned char** strings, size_t n)
+{
+	parallel_burstsort<32000, vector_block<unsigned char*, 128>,
+		uint16_t>(strings, n);
+}
+
 PSS_CONTESTANT(burstsort_vector,
                     "rantala/burstsort_vector",
                     "burstsort with std::vector bucket type")
@@ -521,6 +674,32 @@ PSS_CONTESTANT(burstsort_sampling_superalphabet_vector_block,
                     "rantala/burstsort_sampling_superalphabet_vector_block",
                     "burstsort sampling superalphabet with vector_block bucket type")
 
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_vector,
+                    "rantala/parallel_burstsort_vector",
+                    "parallel burstsort with std::vector bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_brodnik,
+                    "rantala/parallel_burstsort_brodnik",
+                    "parallel burstsort with vector_brodnik bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_bagwell,
+                    "rantala/parallel_burstsort_bagwell",
+                    "parallel burstsort with vector_bagwell bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_vector_block,
+                    "rantala/parallel_burstsort_vector_block",
+                    "parallel burstsort with vector_block bucket type")
+
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_superalphabet_vector,
+                    "rantala/parallel_burstsort_superalphabet_vector",
+                    "parallel burstsort superalphabet with std::vector bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_superalphabet_brodnik,
+                    "rantala/parallel_burstsort_superalphabet_brodnik",
+                    "parallel burstsort superalphabet with vector_brodnik bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_superalphabet_bagwell,
+                    "rantala/parallel_burstsort_superalphabet_bagwell",
+                    "parallel burstsort superalphabet with vector_bagwell bucket type")
+PSS_CONTESTANT_PARALLEL(parallel_burstsort_superalphabet_vector_block,
+                    "rantala/parallel_burstsort_superalphabet_vector_block",
+                    "parallel burstsort superalphabet with vector_block bucket type")
+
 #undef SmallSort
 
 } // namespace rantala_burstsort
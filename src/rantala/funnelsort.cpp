@@ -81,6 +81,11 @@
 #include <assert.h>
 #include <string.h>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <omp.h>
 
 #include <boost/static_assert.hpp>
 #include <boost/array.hpp>
@@ -91,6 +96,9 @@
 #include "tools/insertion_sort.hpp"
 
 #include "../tools/contest.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/stringtools.hpp"
+#include "../tools/jobqueue.hpp"
 
 namespace rantala {
 
@@ -721,6 +729,233 @@ void funnelsort_64way_dfs(unsigned char** strings, size_t n)
 void funnelsort_128way_dfs(unsigned char** strings, size_t n)
 { funnelsort_Kway<128, buffer_layout_dfs>(strings, n); }
 
+//
+// Parallel variants
+//
+
+// The parallel funnelsort splits the input K ways for a fixed number of
+// levels, until the leaves hold at most n/threads strings. Each leaf is sorted
+// by the sequential funnelsort in a job of its own. When all children of a
+// node are sorted, its K-merger is split into parts by splitters sampled from
+// the children, and each part is merged by a job. The output of a node lies in
+// strings or tmp alternating by level, such that the root's output lies in
+// strings and no part overwrites the input of another part.
+
+static inline bool
+string_less(unsigned char* a, unsigned char* b)
+{
+	return cmp(a, b) < 0;
+}
+
+template <unsigned K, template <unsigned, unsigned> class BufferLayout>
+struct FunnelJob;
+
+// Merges one part of a node's K streams.
+template <unsigned K, template <unsigned, unsigned> class BufferLayout>
+struct FunnelMergeJob final : public jobqueue::Job
+{
+	FunnelJob<K,BufferLayout>* node;
+	boost::array<Stream, K> streams;
+	unsigned char** result;
+	size_t n;
+
+	FunnelMergeJob(jobqueue::JobQueue& job_queue,
+	               FunnelJob<K,BufferLayout>* node,
+	               const boost::array<Stream, K>& streams,
+	               unsigned char** result, size_t n)
+		: node(node), streams(streams), result(result), n(n)
+	{
+		job_queue.enqueue(this);
+	}
+
+	virtual bool run(jobqueue::JobQueue& job_queue)
+	{
+		// The root of the merger expects a non-empty left half, hence empty
+		// streams are moved to the back. Equal strings are identical, so
+		// the order of the streams does not matter.
+		std::stable_partition(streams.begin(), streams.end(),
+		                      nonempty);
+		if (n) {
+			boost::array<unsigned char*,
+			             buffer_total_size<K>::value> buffers;
+			boost::array<size_t, K> buffer_count;
+			buffer_count.assign(0);
+			fill_root<K,BufferLayout>(streams, result,
+			                          buffers.c_array(), buffer_count);
+			check_input(result, n);
+		}
+		node->part_done(job_queue);
+		return true;
+	}
+
+	static bool nonempty(const Stream& s) { return s.n != 0; }
+
+	virtual const char* trace_name() const
+	{ return "Funnelsort MergeJob"; }
+
+	virtual size_t trace_size() const
+	{ return n; }
+};
+
+// Node of the parallel recursion, leaves are on level 0.
+template <unsigned K, template <unsigned, unsigned> class BufferLayout>
+struct FunnelJob final : public jobqueue::Job
+{
+	FunnelJob* parent;
+	unsigned char** strings;
+	unsigned char** tmp;
+	size_t n, part_size;
+	unsigned level;
+	// whether the sorted output goes to tmp instead of strings
+	bool out_tmp;
+	// offsets and sizes of the children, relative to strings
+	boost::array<size_t, K> offset, size;
+	// number of unfinished children or merge parts
+	std::atomic<size_t> pending;
+
+	FunnelJob(jobqueue::JobQueue& job_queue, FunnelJob* parent,
+	          unsigned char** strings, unsigned char** tmp, size_t n,
+	          size_t part_size, unsigned level, bool out_tmp)
+		: parent(parent), strings(strings), tmp(tmp), n(n),
+		  part_size(part_size), level(level), out_tmp(out_tmp)
+	{
+		job_queue.enqueue(this);
+	}
+
+	virtual bool run(jobqueue::JobQueue& job_queue)
+	{
+		if (level == 0) {
+			// as in the sequential recursion below a K-merger
+			funnelsort<(K>16?K/4:K/2),BufferLayout>(strings, n, tmp);
+			if (out_tmp)
+				(void) memcpy(tmp, strings,
+				              n*sizeof(unsigned char*));
+			if (parent) parent->child_done(job_queue);
+			return true;
+		}
+		const size_t splitter = n/K;
+		for (unsigned i=0; i < K; ++i) {
+			offset[i] = i*splitter;
+			size[i] = (i < K-1) ? splitter : n - (K-1)*splitter;
+		}
+		// the node is deleted after its last merge part, not by the queue
+		pending = K;
+		for (unsigned i=0; i < K; ++i) {
+			new FunnelJob(job_queue, this, strings+offset[i],
+			              tmp+offset[i], size[i], part_size,
+			              level-1, not out_tmp);
+		}
+		return false;
+	}
+
+	void child_done(jobqueue::JobQueue& job_queue)
+	{
+		if (--pending == 0) merge(job_queue);
+	}
+
+	void part_done(jobqueue::JobQueue& job_queue)
+	{
+		if (--pending != 0) return;
+		if (parent) parent->child_done(job_queue);
+		delete this;
+	}
+
+	// Splits the K-merger into parts of about part_size strings.
+	void merge(jobqueue::JobQueue& job_queue)
+	{
+		unsigned char** in  = out_tmp ? strings : tmp;
+		unsigned char** out = out_tmp ? tmp : strings;
+		size_t parts = (n + part_size - 1) / part_size;
+		std::vector<unsigned char*> samples;
+		const size_t oversampling = 8;
+		for (unsigned i=0; parts > 1 and i < K; ++i) {
+			const size_t m =
+				(oversampling * parts * size[i] + n - 1) / n;
+			for (size_t j=0; j < m; ++j)
+				samples.push_back(in[offset[i] +
+				                     (2*j+1)*size[i]/(2*m)]);
+		}
+		if (samples.empty()) parts = 1;
+		std::sort(samples.begin(), samples.end(), string_less);
+		// pos[i*(parts+1)+p] is the begin of part p in stream i
+		std::vector<size_t> pos(K*(parts+1));
+		for (unsigned i=0; i < K; ++i) {
+			unsigned char** stream = in + offset[i];
+			size_t* ipos = pos.data() + i*(parts+1);
+			ipos[0] = 0;
+			for (size_t p=1; p < parts; ++p) {
+				unsigned char* splitter =
+					samples[p*samples.size()/parts];
+				ipos[p] = std::upper_bound(
+					stream + ipos[p-1], stream + size[i],
+					splitter, string_less) - stream;
+			}
+			ipos[parts] = size[i];
+		}
+		pending = parts;
+		size_t result = 0;
+		for (size_t p=0; p < parts; ++p) {
+			boost::array<Stream, K> streams;
+			size_t count = 0;
+			for (unsigned i=0; i < K; ++i) {
+				const size_t* ipos = pos.data() + i*(parts+1);
+				streams[i].stream = in + offset[i] + ipos[p];
+				streams[i].n = ipos[p+1] - ipos[p];
+				count += streams[i].n;
+			}
+			new FunnelMergeJob<K,BufferLayout>(
+				job_queue, this, streams, out + result, count);
+			result += count;
+		}
+	}
+
+	virtual const char* trace_name() const
+	{ return "Funnelsort FunnelJob"; }
+
+	virtual size_t trace_size() const
+	{ return n; }
+};
+
+template <unsigned K, template <unsigned, unsigned> class BufferLayout>
+void parallel_funnelsort_Kway(unsigned char** strings, size_t n)
+{
+	const size_t threads = omp_get_max_threads();
+	const size_t leaf_size = std::max<size_t>(n/threads, 1024);
+	const size_t part_size = std::max<size_t>(n/(2*threads), 1024);
+	unsigned levels = 0;
+	for (size_t m=n; m > leaf_size; m /= K) ++levels;
+	unsigned char** tmp = static_cast<unsigned char**>(
+			malloc(n*sizeof(unsigned char*)));
+	jobqueue::JobQueue job_queue;
+	new FunnelJob<K,BufferLayout>(job_queue, NULL, strings, tmp, n,
+	                              part_size, levels, false);
+	job_queue.loop();
+	free(tmp);
+	g_stats >> "funnel_levels" << levels;
+}
+
+void parallel_funnelsort_8way_bfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<8, buffer_layout_bfs>(strings, n); }
+void parallel_funnelsort_16way_bfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<16, buffer_layout_bfs>(strings, n); }
+void parallel_funnelsort_32way_bfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<32, buffer_layout_bfs>(strings, n); }
+void parallel_funnelsort_64way_bfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<64, buffer_layout_bfs>(strings, n); }
+void parallel_funnelsort_128way_bfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<128, buffer_layout_bfs>(strings, n); }
+
+void parallel_funnelsort_8way_dfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<8, buffer_layout_dfs>(strings, n); }
+void parallel_funnelsort_16way_dfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<16, buffer_layout_dfs>(strings, n); }
+void parallel_funnelsort_32way_dfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<32, buffer_layout_dfs>(strings, n); }
+void parallel_funnelsort_64way_dfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<64, buffer_layout_dfs>(strings, n); }
+void parallel_funnelsort_128way_dfs(unsigned char** strings, size_t n)
+{ parallel_funnelsort_Kway<128, buffer_layout_dfs>(strings, n); }
+
 PSS_CONTESTANT(funnelsort_8way_bfs,
                     "rantala/funnelsort_8way_bfs",
                     "funnelsort 8way bfs")
@@ -753,4 +988,36 @@ PSS_CONTESTANT(funnelsort_128way_dfs,
                     "rantala/funnelsort_128way_dfs",
                     "funnelsort 128way dfs")
 
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_8way_bfs,
+                    "rantala/parallel_funnelsort_8way_bfs",
+                    "parallel funnelsort 8way bfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_16way_bfs,
+                    "rantala/parallel_funnelsort_16way_bfs",
+                    "parallel funnelsort 16way bfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_32way_bfs,
+                    "rantala/parallel_funnelsort_32way_bfs",
+                    "parallel funnelsort 32way bfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_64way_bfs,
+                    "rantala/parallel_funnelsort_64way_bfs",
+                    "parallel funnelsort 64way bfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_128way_bfs,
+                    "rantala/parallel_funnelsort_128way_bfs",
+                    "parallel funnelsort 128way bfs")
+
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_8way_dfs,
+                    "rantala/parallel_funnelsort_8way_dfs",
+                    "parallel funnelsort 8way dfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_16way_dfs,
+                    "rantala/parallel_funnelsort_16way_dfs",
+                    "parallel funnelsort 16way dfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_32way_dfs,
+                    "rantala/parallel_funnelsort_32way_dfs",
+                    "parallel funnelsort 32way dfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_64way_dfs,
+                    "rantala/parallel_funnelsort_64way_dfs",
+                    "parallel funnelsort 64way dfs")
+PSS_CONTESTANT_PARALLEL(parallel_funnelsort_128way_dfs,
+                    "rantala/parallel_funnelsort_128way_dfs",
+                    "parallel funnelsort 128way dfs")
+
 } // namespace rantala
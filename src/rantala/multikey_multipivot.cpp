@@ -56,10 +56,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include <set>
 
+#include <omp.h>
+
 #include <boost/array.hpp>
 #include <boost/static_assert.hpp>
 
@@ -67,6 +71,9 @@
 #include "tools/get_char.hpp"
 
 #include "../tools/contest.hpp"
+#include "../tools/globals.hpp"
+#include "../tools/stringtools.hpp"
+#include "../tools/jobqueue.hpp"
 #include "../sequential/bs-mkqs.hpp"
 
 namespace rantala {
@@ -427,7 +434,7 @@ multikey_multipivot(unsigned char** strings, size_t n, size_t depth)
 	if (not sorted) {
 		unsigned char** sorted = (unsigned char**)
 			malloc(n*sizeof(unsigned char*));
-		static boost::array<size_t, total_buckets(Pivots)> bucketindex;
+		boost::array<size_t, total_buckets(Pivots)> bucketindex;
 		bucketindex[0] = 0;
 		for (unsigned i=1; i < total_buckets(Pivots); ++i)
 			bucketindex[i] = bucketindex[i-1] + bucketsize[i-1];
@@ -483,4 +490,275 @@ PSS_CONTESTANT(multikey_multipivot_brute_simd4,
                "rantala/multikey_multipivot_brute_simd4",
                "multikey_multipivot brute_simd with 4byte alphabet")
 
+//
+// Parallel variant
+//
+
+// Large subproblems are split into blocks of block_size strings, which are
+// partitioned in two rounds of jobs. First, each job fills the oracle of its
+// block with the SIMD brute force comparison against all pivots, and counts
+// the bucket sizes of the block. Then, after prefix sums over all blocks, each
+// job scatters its block into the shadow array. The buckets are sorted
+// recursively with source and shadow array swapped, until they are small
+// enough for the sequential multikey_multipivot.
+
+static const size_t block_size = 128*1024;
+
+// Source and shadow array of a subproblem. in_tmp is set when the source is a
+// range of the temporary array, sorted output must end up in the other one.
+struct MultipivotRange
+{
+	unsigned char** src;
+	unsigned char** dst;
+	size_t n, depth;
+	bool in_tmp;
+};
+
+template <typename CharT, unsigned Pivots>
+static void
+multipivot_enqueue(jobqueue::JobQueue& job_queue, const MultipivotRange& r,
+                   size_t threshold);
+
+template <typename CharT, unsigned Pivots>
+struct MultipivotSeqJob final : public jobqueue::Job
+{
+	MultipivotRange r;
+
+	MultipivotSeqJob(jobqueue::JobQueue& job_queue,
+	                 const MultipivotRange& r)
+		: r(r)
+	{
+		job_queue.enqueue(this);
+	}
+
+	virtual bool run(jobqueue::JobQueue&)
+	{
+		unsigned char** strings = r.src;
+		if (r.in_tmp) {
+			(void) memcpy(r.dst, r.src, r.n*sizeof(unsigned char*));
+			strings = r.dst;
+		}
+		multikey_multipivot<CharT, Pivots>(strings, r.n, r.depth);
+		return true;
+	}
+
+	virtual const char* trace_name() const
+	{ return "Multipivot SeqJob"; }
+
+	virtual size_t trace_size() const
+	{ return r.n; }
+};
+
+template <typename CharT, unsigned Pivots>
+struct MultipivotStep
+{
+	enum { Buckets = total_buckets(Pivots) };
+
+	MultipivotRange r;
+	size_t threshold;
+	boost::array<CharT, Pivots> pivots;
+	size_t blocks;
+	uint8_t* oracle;
+	// bucket sizes, then output positions, of each block and bucket
+	std::vector<size_t> bkt;
+	boost::array<size_t, Buckets> bucketsize;
+	// number of unfinished block jobs
+	std::atomic<size_t> pwork;
+
+	MultipivotStep(jobqueue::JobQueue& job_queue,
+	               const MultipivotRange& r, size_t threshold);
+
+	void count(jobqueue::JobQueue& job_queue, size_t b);
+	void scatter(jobqueue::JobQueue& job_queue, size_t b);
+	void recurse(jobqueue::JobQueue& job_queue);
+};
+
+template <typename CharT, unsigned Pivots>
+struct MultipivotBlockJob final : public jobqueue::Job
+{
+	MultipivotStep<CharT, Pivots>* step;
+	size_t b;
+	bool scatter;
+
+	MultipivotBlockJob(jobqueue::JobQueue& job_queue,
+	                   MultipivotStep<CharT, Pivots>* step,
+	                   size_t b, bool scatter)
+		: step(step), b(b), scatter(scatter)
+	{
+		job_queue.enqueue(this);
+	}
+
+	virtual bool run(jobqueue::JobQueue& job_queue)
+	{
+		if (scatter) step->scatter(job_queue, b);
+		else step->count(job_queue, b);
+		return true;
+	}
+
+	virtual const char* trace_name() const
+	{ return scatter ? "Multipivot ScatterJob" : "Multipivot CountJob"; }
+
+	virtual size_t trace_size() const
+	{ return block_size; }
+};
+
+// Selects distinct pivots from runs of 7 characters at evenly spaced
+// positions, like multikey_multipivot() but without the shared state of
+// drand48().
+template <typename CharT, unsigned Pivots>
+static void
+sample_pivots(unsigned char** strings, size_t n, size_t depth,
+              boost::array<CharT, Pivots>& pivots)
+{
+	std::set<CharT> sample;
+	for (unsigned i=0; i < Pivots; ++i) {
+		size_t pos = (n-7)*(2*i+1)/(2*Pivots);
+		for (unsigned j=0; j < 7; ++j)
+			sample.insert(get_char<CharT>(strings[pos+j], depth));
+	}
+	for (CharT i=1; sample.size() < Pivots; ++i) {
+		if (is_end(i)) ++i;
+		sample.insert(i);
+	}
+	std::vector<CharT> sample_array(sample.begin(), sample.end());
+	unsigned step = sample_array.size() / Pivots;
+	for (unsigned i=0; i < Pivots; ++i)
+		pivots[i] = sample_array[step*i];
+}
+
+template <typename CharT, unsigned Pivots>
+MultipivotStep<CharT, Pivots>::MultipivotStep(
+		jobqueue::JobQueue& job_queue,
+		const MultipivotRange& r, size_t threshold)
+	: r(r), threshold(threshold),
+	  blocks((r.n + block_size - 1) / block_size),
+	  oracle(static_cast<uint8_t*>(_mm_malloc(r.n, 16))),
+	  bkt(blocks*Buckets, 0)
+{
+	sample_pivots<CharT, Pivots>(r.src, r.n, r.depth, pivots);
+	pwork = blocks;
+	for (size_t b=0; b < blocks; ++b)
+		new MultipivotBlockJob<CharT, Pivots>(job_queue, this, b, false);
+}
+
+template <typename CharT, unsigned Pivots>
+void MultipivotStep<CharT, Pivots>::count(jobqueue::JobQueue& job_queue,
+                                          size_t b)
+{
+	const size_t begin = b*block_size;
+	const size_t n = std::min(block_size, r.n - begin);
+	// block_size keeps oracle+begin 16-byte aligned for the SIMD stores
+	fill_oracle<Pivots>(r.src+begin, n, oracle+begin, pivots, r.depth);
+	size_t* mybkt = bkt.data() + b*Buckets;
+	for (size_t i=begin; i < begin+n; ++i)
+		++mybkt[oracle[i]];
+	if (--pwork != 0) return;
+	// exclusive prefix sum in bucket-major, block-minor order
+	size_t sum = 0;
+	for (unsigned k=0; k < Buckets; ++k) {
+		const size_t bucketbegin = sum;
+		for (size_t p=0; p < blocks; ++p) {
+			const size_t size = bkt[p*Buckets+k];
+			bkt[p*Buckets+k] = sum;
+			sum += size;
+		}
+		bucketsize[k] = sum - bucketbegin;
+	}
+	assert(sum == r.n);
+	pwork = blocks;
+	for (size_t p=0; p < blocks; ++p)
+		new MultipivotBlockJob<CharT, Pivots>(job_queue, this, p, true);
+}
+
+template <typename CharT, unsigned Pivots>
+void MultipivotStep<CharT, Pivots>::scatter(jobqueue::JobQueue& job_queue,
+                                            size_t b)
+{
+	const size_t begin = b*block_size;
+	const size_t end = begin + std::min(block_size, r.n - begin);
+	size_t* mybkt = bkt.data() + b*Buckets;
+	for (size_t i=begin; i < end; ++i)
+		r.dst[mybkt[oracle[i]]++] = r.src[i];
+	if (--pwork == 0) recurse(job_queue);
+}
+
+template <typename CharT, unsigned Pivots>
+void MultipivotStep<CharT, Pivots>::recurse(jobqueue::JobQueue& job_queue)
+{
+	_mm_free(oracle);
+	size_t bsum = 0;
+	for (unsigned k=0; k < Buckets; ++k) {
+		MultipivotRange c;
+		c.src = r.dst + bsum;
+		c.dst = r.src + bsum;
+		c.n = bucketsize[k];
+		c.in_tmp = not r.in_tmp;
+		bsum += c.n;
+		if (c.n == 0) continue;
+		// same depth calculation as in multikey_multipivot()
+		const unsigned i = k/2;
+		bool done = false;
+		if (k == Buckets-1 or k == left_bucket(0)) {
+			c.depth = r.depth;
+		} else if (k == middle_bucket(i)) {
+			done = is_end(pivots[i]);
+			c.depth = r.depth + sizeof(CharT);
+		} else {
+			c.depth = r.depth + lcp(pivots[i-1], pivots[i]);
+		}
+		if (done or c.n == 1) {
+			if (c.in_tmp)
+				(void) memcpy(c.dst, c.src,
+				              c.n*sizeof(unsigned char*));
+			continue;
+		}
+		multipivot_enqueue<CharT, Pivots>(job_queue, c, threshold);
+	}
+	delete this;
+}
+
+template <typename CharT, unsigned Pivots>
+static void
+multipivot_enqueue(jobqueue::JobQueue& job_queue, const MultipivotRange& r,
+                   size_t threshold)
+{
+	if (r.n > threshold)
+		new MultipivotStep<CharT, Pivots>(job_queue, r, threshold);
+	else
+		new MultipivotSeqJob<CharT, Pivots>(job_queue, r);
+}
+
+template <typename CharT, unsigned Pivots>
+static void
+multikey_multipivot_parallel(unsigned char** strings, size_t n)
+{
+	unsigned char** tmp = static_cast<unsigned char**>(
+			malloc(n*sizeof(unsigned char*)));
+	MultipivotRange r = { strings, tmp, n, 0, false };
+	jobqueue::JobQueue job_queue;
+	multipivot_enqueue<CharT, Pivots>(job_queue, r,
+		std::max<size_t>(block_size, n/omp_get_max_threads()));
+	job_queue.loop();
+	free(tmp);
+}
+
+void multikey_multipivot_parallel_simd1(unsigned char** strings, size_t n)
+{ multikey_multipivot_parallel<unsigned char, 16>(strings, n); }
+
+void multikey_multipivot_parallel_simd2(unsigned char** strings, size_t n)
+{ multikey_multipivot_parallel<uint16_t, 32>(strings, n); }
+
+void multikey_multipivot_parallel_simd4(unsigned char** strings, size_t n)
+{ multikey_multipivot_parallel<uint32_t, 32>(strings, n); }
+
+PSS_CONTESTANT_PARALLEL(multikey_multipivot_parallel_simd1,
+               "rantala/multikey_multipivot_parallel_simd1",
+               "parallel multikey_multipivot brute_simd with 1byte alphabet")
+PSS_CONTESTANT_PARALLEL(multikey_multipivot_parallel_simd2,
+               "rantala/multikey_multipivot_parallel_simd2",
+               "parallel multikey_multipivot brute_simd with 2byte alphabet")
+PSS_CONTESTANT_PARALLEL(multikey_multipivot_parallel_simd4,
+               "rantala/multikey_multipivot_parallel_simd4",
+               "parallel multikey_multipivot brute_simd with 4byte alphabet")
+
 } // namespace rantala
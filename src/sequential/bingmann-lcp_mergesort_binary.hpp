@@ -25,6 +25,8 @@
 #ifndef PSS_SRC_SEQUENTIAL_BINGMANN_LCP_MERGESORT_BINARY_HEADER
 #define PSS_SRC_SEQUENTIAL_BINGMANN_LCP_MERGESORT_BINARY_HEADER
 
+#include <vector>
+
 #include "../tools/stringtools.hpp"
 #include "../tools/contest.hpp"
 #include "bingmann-lcp_inssort.hpp"
@@ -319,7 +321,7 @@ lcp_mergesort_binary_opt(
     lcp_merge_binary_opt(tmp1, tmp2, out);
 }
 
-void
+static inline void
 lcp_mergesort_binary_opt(string* strings, uintptr_t* lcp, size_t n)
 {
     // Allocate memory for LCPs and temporary string array
@@ -551,7 +553,7 @@ lcp_mergesort_binary_cache_opt(
     lcp_merge_binary_cache_opt(tmp1, tmp2, out);
 }
 
-void
+static inline void
 lcp_mergesort_binary_cache_opt(string* strings, uintptr_t* lcp, uint8_t* cache, size_t n)
 {
     // Allocate memory for LCPs and temporary string array
@@ -575,6 +577,180 @@ PSS_CONTESTANT(lcp_mergesort_binary_cache_opt,
                "bingmann/lcp_mergesort_binary_cache_opt",
                "Binary LCP-Mergesort by Timo Bingmann and Andreas Eberle")
 
+/******************************************************************************/
+// Generic binary LCP-Mergesort on StringSets
+
+//! LCP-aware merge of the sorted StringSets ss1 and ss2 with LCP arrays lcps1
+//! and lcps2 into out and out_lcp. All strings share a common prefix of depth.
+//! The strings are compared only using the StringSet's CharIterators, hence
+//! this also works on binary strings containing zeros.
+template <typename StringSet>
+static inline void
+lcp_merge_binary_generic(
+    const StringSet& ss1, const uintptr_t* lcps1,
+    const StringSet& ss2, const uintptr_t* lcps2,
+    size_t depth, const StringSet& out, uintptr_t* out_lcp)
+{
+    typedef typename StringSet::Iterator Iterator;
+    typedef typename StringSet::CharIterator CharIterator;
+
+    Iterator input1 = ss1.begin(), end1 = ss1.end();
+    Iterator input2 = ss2.begin(), end2 = ss2.end();
+    Iterator output = out.begin();
+
+    size_t lcp1 = depth, lcp2 = depth;
+
+    // do the merge
+    while (input1 != end1 && input2 != end2)
+    {
+        if (lcp1 == lcp2)
+        {
+            // CASE 1 lcps are equal => do string comparision starting at
+            // lcp+1st position
+            CharIterator c1 = ss1.get_chars(ss1[input1], lcp1);
+            CharIterator c2 = ss2.get_chars(ss2[input2], lcp1);
+
+            // check the strings starting after lcp and calculate new lcp
+            size_t lcp = lcp1;
+            while (ss1.is_equal(ss1[input1], c1, ss2[input2], c2))
+                ++c1, ++c2, ++lcp;
+
+            if (ss1.is_leq(ss1[input1], c1, ss2[input2], c2))
+            {
+                // CASE 1.1: input1 <= input2
+                out[output] = std::move(ss1[input1]);
+                *out_lcp = lcp1;
+                ++input1, ++lcps1;
+                if (input1 != end1) lcp1 = *lcps1;
+                lcp2 = lcp;
+            }
+            else
+            {
+                // CASE 1.2: input1 > input2
+                out[output] = std::move(ss2[input2]);
+                *out_lcp = lcp2;
+                ++input2, ++lcps2;
+                lcp1 = lcp;
+                if (input2 != end2) lcp2 = *lcps2;
+            }
+        }
+        else if (lcp1 < lcp2)
+        {
+            // CASE 2: input1 > input2
+            out[output] = std::move(ss2[input2]);
+            *out_lcp = lcp2;
+            ++input2, ++lcps2;
+            if (input2 != end2) lcp2 = *lcps2;
+        }
+        else
+        {
+            // CASE 3: input1 < input2
+            out[output] = std::move(ss1[input1]);
+            *out_lcp = lcp1;
+            ++input1, ++lcps1;
+            if (input1 != end1) lcp1 = *lcps1;
+        }
+
+        ++output, ++out_lcp;
+    }
+
+    if (input1 != end1)
+    {
+        // if there are remaining elements in stream1, move them to the end
+        std::move(input1, end1, output);
+        std::copy(lcps1, lcps1 + (end1 - input1), out_lcp);
+        *out_lcp = lcp1;
+    }
+    else
+    {
+        std::move(input2, end2, output);
+        std::copy(lcps2, lcps2 + (end2 - input2), out_lcp);
+        *out_lcp = lcp2;
+    }
+}
+
+template <typename StringSet>
+static inline void
+lcp_mergesort_binary_generic(
+    const StringSet& ss, uintptr_t* lcp,
+    const StringSet& tmp, uintptr_t* tmp_lcp, size_t depth);
+
+//! sort the strings of ss into out, using ss and lcp as scratch space.
+template <typename StringSet>
+static inline void
+lcp_mergesort_binary_generic_out(
+    const StringSet& ss, uintptr_t* lcp,
+    const StringSet& out, uintptr_t* out_lcp, size_t depth)
+{
+    size_t n = ss.size();
+
+    if (n <= 32) {
+        std::move(ss.begin(), ss.end(), out.begin());
+        return bingmann::lcp_insertion_sort(out, out_lcp, depth);
+    }
+
+    size_t mid = n / 2;
+
+    lcp_mergesort_binary_generic(
+        ss.subi(0, mid), lcp, out.subi(0, mid), out_lcp, depth);
+    lcp_mergesort_binary_generic(
+        ss.subi(mid, n), lcp + mid, out.subi(mid, n), out_lcp + mid, depth);
+
+    lcp_merge_binary_generic(ss.subi(0, mid), lcp, ss.subi(mid, n), lcp + mid,
+                             depth, out, out_lcp);
+}
+
+//! sort the strings of ss in place, using tmp and tmp_lcp as scratch space.
+template <typename StringSet>
+static inline void
+lcp_mergesort_binary_generic(
+    const StringSet& ss, uintptr_t* lcp,
+    const StringSet& tmp, uintptr_t* tmp_lcp, size_t depth)
+{
+    size_t n = ss.size();
+
+    if (n <= 32)
+        return bingmann::lcp_insertion_sort(ss, lcp, depth);
+
+    size_t mid = n / 2;
+
+    lcp_mergesort_binary_generic_out(
+        ss.subi(0, mid), lcp, tmp.subi(0, mid), tmp_lcp, depth);
+    lcp_mergesort_binary_generic_out(
+        ss.subi(mid, n), lcp + mid, tmp.subi(mid, n), tmp_lcp + mid, depth);
+
+    lcp_merge_binary_generic(tmp.subi(0, mid), tmp_lcp,
+                             tmp.subi(mid, n), tmp_lcp + mid,
+                             depth, ss, lcp);
+}
+
+//! Binary LCP-Mergesort on a generic StringSet, outputs the LCP array.
+template <typename StringSet>
+static inline void
+lcp_mergesort_binary_generic(
+    const StringSet& ss, uintptr_t* lcp, size_t depth)
+{
+    typename StringSet::Container tmp = ss.allocate(ss.size());
+    std::vector<uintptr_t> tmp_lcp(ss.size());
+
+    lcp_mergesort_binary_generic(
+        ss, lcp, StringSet(tmp), tmp_lcp.data(), depth);
+
+    StringSet::deallocate(tmp);
+}
+
+//! Binary LCP-Mergesort on a generic StringSet, but check and discard the LCP
+//! array.
+template <typename StringSet>
+static inline void
+lcp_mergesort_binary_verify(const StringSet& ss, size_t depth)
+{
+    std::vector<uintptr_t> lcp(ss.size());
+    lcp_mergesort_binary_generic(ss, lcp.data(), depth);
+    lcp[0] = 42;
+    die_unless(stringtools::verify_lcp(ss, lcp.data(), 42));
+}
+
 } // namespace bingmann
 
 #endif // !PSS_SRC_SEQUENTIAL_BINGMANN_LCP_MERGESORT_BINARY_HEADER
@@ -530,7 +530,7 @@ msd_CI2_bktsize_generic(
     // cache characters
     Char* cc = charcache;
     for (Iterator i = ss.begin(); i != ss.end(); ++i, ++cc)
-        *cc = *ss.get_chars(ss[i], depth);
+        *cc = ss.get_char(ss[i], depth);
 
     // count character occurances
     size_t* bkt_size = new size_t[256]();
@@ -27,6 +27,7 @@
 #include "bingmann-sample_sortBTC.hpp"
 #include "bingmann-sample_sortBTCE.hpp"
 #include "bingmann-sample_sortBTCT.hpp"
+#include "bingmann-sample_sortKTS.hpp"
 
 #include <tlx/die.hpp>
 
@@ -283,6 +284,20 @@ void bingmann_sample_sortBTCTU(string* strings, size_t n)
 PSS_CONTESTANT(bingmann_sample_sortBTCTU, "bingmann/sample_sortBTCTU",
                "bingmann/sample_sortBTCTU (binary tree, bkt cache, tree calc)")
 
+void bingmann_sample_sortKTS(string* strings, size_t n)
+{
+    using Classify = ClassifySimdTree<>;
+    sample_sort_pre();
+    g_stats >> "numsplitters" << size_t(Classify::numsplitters)
+        >> "splitter_treebits" << size_t(Classify::treebits)
+        >> "simd" << simd_level_name(simd_level_detect());
+    sample_sort_generic<Classify>(strings, n, 0);
+    sample_sort_post();
+}
+
+PSS_CONTESTANT(bingmann_sample_sortKTS, "bingmann/sample_sortKTS",
+               "bingmann/sample_sortKTS (k-ary SIMD tree, bkt cache)")
+
 void bingmann_sample_sortBTCTUI(string* strings, size_t n)
 {
     using Classify = ClassifyTreeCalcUnrollInterleave<>;
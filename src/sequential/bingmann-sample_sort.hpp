@@ -119,6 +119,8 @@ void bingmann_sample_sortBTCEA(string* strings, size_t n);
 void bingmann_sample_sortBTCT(string* strings, size_t n);
 void bingmann_sample_sortBTCTU(string* strings, size_t n);
 
+void bingmann_sample_sortKTS(string* strings, size_t n);
+
 } // namespace bingmann_sample_sort
 
 #endif // !PSS_SRC_SEQUENTIAL_BINGMANN_SAMPLE_SORT_HEADER
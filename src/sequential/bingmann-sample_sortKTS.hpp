@@ -0,0 +1,405 @@
+/*******************************************************************************
+ * src/sequential/bingmann-sample_sortKTS.hpp
+ *
+ * Experiments with sequential Super Scalar String Sample-Sort (S^5).
+ *
+ * K-ary splitter tree searched with SIMD comparisons, with bucket cache.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_SEQUENTIAL_BINGMANN_SAMPLE_SORTKTS_HEADER
+#define PSS_SRC_SEQUENTIAL_BINGMANN_SAMPLE_SORTKTS_HEADER
+
+#include "bingmann-sample_sort.hpp"
+#include "bingmann-sample_sort_tree_builder.hpp"
+#include "../tools/stringset.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SSSS_SIMD_X86 1
+#else
+#define SSSS_SIMD_X86 0
+#endif
+
+namespace bingmann_sample_sort {
+
+//! SIMD instruction set used by ClassifySimdTree
+enum SimdLevel {
+    SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2
+};
+
+//! detect the best SIMD instruction set of the running CPU (cached)
+static inline SimdLevel simd_level_detect()
+{
+#if SSSS_SIMD_X86
+    static const SimdLevel level =
+        __builtin_cpu_supports("avx512f") ? SIMD_AVX512 :
+        __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SCALAR;
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+//! name of SIMD instruction set, for statistics output
+static inline const char * simd_level_name(SimdLevel level)
+{
+    return level == SIMD_AVX512 ? "avx512" :
+           level == SIMD_AVX2 ? "avx2" : "scalar";
+}
+
+/*!
+ * Classifier searching a k-ary splitter tree with SIMD comparisons. Each tree
+ * node holds B = 4 (AVX2) or B = 8 (AVX-512) sorted splitters, which are
+ * compared with the key in one instruction. The number of splitters less than
+ * the key selects one of the B+1 children. Nodes are stored in level-order,
+ * children of node k are k * (B+1) + 1 + c, hence the tree has only about
+ * log_{B+1}(numsplitters) levels instead of treebits.
+ *
+ * The instruction set is selected at runtime in build(), on CPUs without AVX2
+ * the same tree is searched with a scalar loop.
+ */
+template <size_t TreeBits = DefaultTreebits>
+class ClassifySimdTree
+{
+public:
+    static const size_t treebits = TreeBits;
+    static const size_t numsplitters = (1 << treebits) - 1;
+
+    //! maximum number of splitters per node (AVX-512)
+    static const size_t max_node_size = 8;
+
+    //! tree slots: numsplitters rounded up to whole nodes
+    static const size_t numslots =
+        (numsplitters + max_node_size - 1) / max_node_size * max_node_size;
+
+    //! k-ary tree of splitters in level-order, padded with maximum keys. For
+    //! AVX2 the keys are stored with flipped sign bit.
+    key_type tree[numslots];
+
+    //! index of tree slot's splitter in sorted order, numsplitters = padding
+    uint16_t tree_rank[numslots];
+
+    //! sorted splitter array
+    key_type splitter[numsplitters];
+
+    //! instruction set the tree was built for
+    SimdLevel simd;
+
+    //! number of splitters per node, number of nodes, and number of levels
+    unsigned node_size, num_nodes, num_levels;
+
+    //! number of keys descending the tree interleaved
+    static const unsigned Rollout = 4;
+
+    //! return number of splitters less than key: descend tree and remember the
+    //! rank of the last node slot which was >= key.
+    unsigned int find_rank_scalar(const key_type& key) const
+    {
+        unsigned int rank = numsplitters;
+
+        for (unsigned int k = 0; k < num_nodes; )
+        {
+            const key_type* node = tree + k * node_size;
+
+            unsigned int c = 0;
+            for (unsigned int j = 0; j < node_size; ++j)
+                c += (key > node[j]);
+
+            if (c < node_size) rank = tree_rank[k * node_size + c];
+            k = k * (node_size + 1) + 1 + c;
+        }
+
+        return rank;
+    }
+
+#if SSSS_SIMD_X86
+    //! descend one level from node k using AVX2 compares of four keys (signed,
+    //! hence sign bits are flipped in vkey and the tree).
+    __attribute__ ((target("avx2")))
+    void step_avx2(const __m256i& vkey,
+                   unsigned int& k, unsigned int& rank) const
+    {
+        __m256i vnode = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(tree + k * 4));
+
+        unsigned int mask = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(vkey, vnode)));
+        unsigned int c = __builtin_popcount(mask);
+
+        if (c < 4) rank = tree_rank[k * 4 + c];
+        k = k * 5 + 1 + c;
+    }
+
+    //! key broadcast for step_avx2()
+    __attribute__ ((target("avx2")))
+    static __m256i key_avx2(const key_type& key)
+    {
+        return _mm256_set1_epi64x(
+            static_cast<int64_t>(key ^ 0x8000000000000000LLU));
+    }
+
+    //! return number of splitters less than key using AVX2
+    __attribute__ ((target("avx2")))
+    unsigned int find_rank_avx2(const key_type& key) const
+    {
+        const __m256i vkey = key_avx2(key);
+        unsigned int k = 0, rank = numsplitters;
+        while (k < num_nodes) step_avx2(vkey, k, rank);
+        return rank;
+    }
+
+    //! descend one level from node k using AVX-512 compares of eight keys.
+    __attribute__ ((target("avx512f")))
+    void step_avx512(const __m512i& vkey,
+                     unsigned int& k, unsigned int& rank) const
+    {
+        __m512i vnode = _mm512_loadu_si512(tree + k * 8);
+
+        unsigned int c = __builtin_popcount(
+            _mm512_cmpgt_epu64_mask(vkey, vnode));
+
+        if (c < 8) rank = tree_rank[k * 8 + c];
+        k = k * 9 + 1 + c;
+    }
+
+    //! key broadcast for step_avx512()
+    __attribute__ ((target("avx512f")))
+    static __m512i key_avx512(const key_type& key)
+    {
+        return _mm512_set1_epi64(static_cast<int64_t>(key));
+    }
+
+    //! return number of splitters less than key using AVX-512
+    __attribute__ ((target("avx512f")))
+    unsigned int find_rank_avx512(const key_type& key) const
+    {
+        const __m512i vkey = key_avx512(key);
+        unsigned int k = 0, rank = numsplitters;
+        while (k < num_nodes) step_avx512(vkey, k, rank);
+        return rank;
+    }
+#endif
+
+    //! return number of splitters less than key with the built tree's kernel
+    unsigned int find_rank(const key_type& key) const
+    {
+#if SSSS_SIMD_X86
+        if (simd == SIMD_AVX512) return find_rank_avx512(key);
+        if (simd == SIMD_AVX2) return find_rank_avx2(key);
+#endif
+        return find_rank_scalar(key);
+    }
+
+    //! convert number of splitters less than key to bucket number
+    unsigned int rank_to_bkt(unsigned int i, const key_type& key) const
+    {
+        unsigned int b = i * 2;                               // < bucket
+        if (i < numsplitters && splitter[i] == key) b += 1; // equal bucket
+        return b;
+    }
+
+    //! search splitter tree for bucket number
+    unsigned int find_bkt(const key_type& key) const
+    {
+        return rank_to_bkt(find_rank(key), key);
+    }
+
+    //! classify strings with the scalar kernel
+    template <typename StringSet>
+    void classify_scalar(
+        const StringSet& strset,
+        typename StringSet::Iterator begin, typename StringSet::Iterator end,
+        uint16_t* bktout, size_t depth) const
+    {
+        while (begin != end)
+        {
+            key_type key = strset.get_uint64(*begin++, depth);
+            *bktout++ = rank_to_bkt(find_rank_scalar(key), key);
+        }
+    }
+
+#if SSSS_SIMD_X86
+    //! classify strings with the AVX2 kernel, descending the tree with Rollout
+    //! keys interleaved.
+    template <typename StringSet>
+    __attribute__ ((target("avx2")))
+    void classify_avx2(
+        const StringSet& strset,
+        typename StringSet::Iterator begin, typename StringSet::Iterator end,
+        uint16_t* bktout, size_t depth) const
+    {
+        while (begin + Rollout <= end)
+        {
+            key_type key[Rollout];
+            __m256i vkey[Rollout];
+            unsigned int k[Rollout], rank[Rollout];
+
+            for (unsigned u = 0; u < Rollout; ++u) {
+                key[u] = strset.get_uint64(begin[u], depth);
+                vkey[u] = key_avx2(key[u]);
+                k[u] = 0, rank[u] = numsplitters;
+            }
+
+            for (unsigned l = 0; l < num_levels; ++l) {
+                for (unsigned u = 0; u < Rollout; ++u) {
+                    if (k[u] < num_nodes) step_avx2(vkey[u], k[u], rank[u]);
+                }
+            }
+
+            for (unsigned u = 0; u < Rollout; ++u)
+                bktout[u] = rank_to_bkt(rank[u], key[u]);
+
+            begin += Rollout;
+            bktout += Rollout;
+        }
+
+        while (begin != end)
+        {
+            key_type key = strset.get_uint64(*begin++, depth);
+            *bktout++ = rank_to_bkt(find_rank_avx2(key), key);
+        }
+    }
+
+    //! classify strings with the AVX-512 kernel, descending the tree with
+    //! Rollout keys interleaved.
+    template <typename StringSet>
+    __attribute__ ((target("avx512f")))
+    void classify_avx512(
+        const StringSet& strset,
+        typename StringSet::Iterator begin, typename StringSet::Iterator end,
+        uint16_t* bktout, size_t depth) const
+    {
+        while (begin + Rollout <= end)
+        {
+            key_type key[Rollout];
+            __m512i vkey[Rollout];
+            unsigned int k[Rollout], rank[Rollout];
+
+            for (unsigned u = 0; u < Rollout; ++u) {
+                key[u] = strset.get_uint64(begin[u], depth);
+                vkey[u] = key_avx512(key[u]);
+                k[u] = 0, rank[u] = numsplitters;
+            }
+
+            for (unsigned l = 0; l < num_levels; ++l) {
+                for (unsigned u = 0; u < Rollout; ++u) {
+                    if (k[u] < num_nodes) step_avx512(vkey[u], k[u], rank[u]);
+                }
+            }
+
+            for (unsigned u = 0; u < Rollout; ++u)
+                bktout[u] = rank_to_bkt(rank[u], key[u]);
+
+            begin += Rollout;
+            bktout += Rollout;
+        }
+
+        while (begin != end)
+        {
+            key_type key = strset.get_uint64(*begin++, depth);
+            *bktout++ = rank_to_bkt(find_rank_avx512(key), key);
+        }
+    }
+#endif
+
+    //! classify all strings in area by walking tree and saving bucket id
+    template <typename StringSet>
+    void classify(
+        const StringSet& strset,
+        typename StringSet::Iterator begin, typename StringSet::Iterator end,
+        uint16_t* bktout, size_t depth) const
+    {
+#if SSSS_SIMD_X86
+        if (simd == SIMD_AVX512)
+            return classify_avx512(strset, begin, end, bktout, depth);
+        if (simd == SIMD_AVX2)
+            return classify_avx2(strset, begin, end, bktout, depth);
+#endif
+        return classify_scalar(strset, begin, end, bktout, depth);
+    }
+
+    //! classify all strings in area by walking tree and saving bucket id
+    void classify(string* strB, string* strE, uint16_t* bktout, size_t depth)
+    {
+        return classify(
+            parallel_string_sorting::UCharStringSet(strB, strE),
+            strB, strE, bktout, depth);
+    }
+
+    //! return a splitter
+    key_type get_splitter(unsigned int i) const
+    { return splitter[i]; }
+
+    //! fill subtree of node k in-order with sorted splitters from index t
+    void build_subtree(unsigned int k, unsigned int& t, key_type flip)
+    {
+        if (k >= num_nodes) return;
+
+        for (unsigned int c = 0; c <= node_size; ++c)
+        {
+            build_subtree(k * (node_size + 1) + 1 + c, t, flip);
+            if (c == node_size) break;
+
+            unsigned int s = k * node_size + c;
+            if (t < numsplitters) {
+                tree[s] = splitter[t] ^ flip;
+                tree_rank[s] = t++;
+            }
+            else {
+                // padding is never less than a key
+                tree[s] = key_type(-1) ^ flip;
+                tree_rank[s] = numsplitters;
+            }
+        }
+    }
+
+    //! build tree and splitter array from sample for the given instruction set
+    void build(key_type* samples, size_t samplesize,
+               unsigned char* splitter_lcp, SimdLevel level)
+    {
+        bingmann_sample_sort::TreeBuilderPreorder<numsplitters>(
+            splitter, splitter_lcp, samples, samplesize);
+
+        simd = level;
+        node_size = (simd == SIMD_AVX512) ? 8 : 4;
+        num_nodes = (numsplitters + node_size - 1) / node_size;
+
+        num_levels = 0;
+        for (size_t first = 0, width = 1; first < num_nodes;
+             first += width, width *= node_size + 1)
+            ++num_levels;
+
+        unsigned int t = 0;
+        build_subtree(0, t, simd == SIMD_AVX2 ? 0x8000000000000000LLU : 0);
+        assert(t == numsplitters);
+    }
+
+    //! build tree and splitter array from sample
+    void build(key_type* samples, size_t samplesize,
+               unsigned char* splitter_lcp)
+    {
+        return build(samples, samplesize, splitter_lcp, simd_level_detect());
+    }
+};
+
+} // namespace bingmann_sample_sort
+
+#endif // !PSS_SRC_SEQUENTIAL_BINGMANN_SAMPLE_SORTKTS_HEADER
+
+/******************************************************************************/
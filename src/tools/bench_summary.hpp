@@ -0,0 +1,316 @@
+/*******************************************************************************
+ * src/tools/bench_summary.hpp
+ *
+ * Summary of repeated benchmark runs over a grid of input sizes and thread
+ * counts: repeats each configuration until the confidence interval of its mean
+ * time is small enough and writes median, min, stddev, speedup and parallel
+ * efficiency of all configurations as CSV or JSON.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_TOOLS_BENCH_SUMMARY_HEADER
+#define PSS_SRC_TOOLS_BENCH_SUMMARY_HEADER
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+/*!
+ * Collector of timings for benchmark mode. Each configuration of algorithm,
+ * input and thread count is opened with begin(), then the algorithm is run
+ * while repeat() returns true, and closed with end(), which rewrites the whole
+ * output file. Thus a partial result survives an aborted benchmark.
+ *
+ * The run itself stores its time in result(), which lives in shared memory,
+ * such that runs in a child process (-F, -D) reach the parent. A run which is
+ * skipped, fails its check, or is killed leaves no valid result and ends the
+ * configuration.
+ *
+ * The speedup of a parallel configuration is relative to the one with the
+ * fewest threads of the same algorithm and input, which usually is p = 1.
+ */
+class BenchSummary
+{
+public:
+    //! time of one run, written by the run, possibly in a child process
+    struct Result
+    {
+        //! wall time of the run in seconds
+        double time;
+        //! string and character count of the input
+        size_t string_count, char_count;
+        //! true if the run finished and its output was correct
+        bool valid;
+    };
+
+    //! summary of one configuration
+    struct Row
+    {
+        std::string algo, data;
+        size_t char_count, string_count, threads;
+        //! number of runs started
+        size_t runs;
+        //! all times in seconds, sorted by end()
+        std::vector<double> times;
+        //! relative confidence interval reached
+        double ci;
+        //! false if a run failed
+        bool ok;
+    };
+
+protected:
+    //! output path, written as JSON if it ends with ".json", else CSV
+    std::string m_path;
+
+    //! relative half width of the 95% confidence interval to reach
+    double m_ci_target;
+
+    //! minimum and maximum number of repetitions
+    size_t m_min_repeats, m_max_repeats;
+
+    //! result slot in memory shared with forked children
+    Result* m_result;
+
+    //! whether m_result was mapped, else it was allocated
+    bool m_shared;
+
+    //! finished configurations and the current one at the back
+    std::vector<Row> m_rows;
+
+    //! two-sided 97.5% quantile of Student's t distribution for df degrees
+    //! of freedom
+    static double student_t(size_t df)
+    {
+        static const double table[30] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+            2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+            2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+            2.048, 2.045, 2.042
+        };
+        return df == 0 ? INFINITY : df <= 30 ? table[df - 1] : 1.960;
+    }
+
+    static double mean(const std::vector<double>& v)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < v.size(); ++i) sum += v[i];
+        return sum / v.size();
+    }
+
+    static double stddev(const std::vector<double>& v)
+    {
+        if (v.size() < 2) return 0;
+        double m = mean(v), sum = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+            sum += (v[i] - m) * (v[i] - m);
+        return std::sqrt(sum / (v.size() - 1));
+    }
+
+    static double median(const std::vector<double>& sorted)
+    {
+        size_t n = sorted.size();
+        if (n == 0) return 0;
+        return n % 2 ? sorted[n / 2]
+               : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+
+    //! relative half width of the 95% confidence interval of the mean
+    static double rel_ci(const std::vector<double>& v)
+    {
+        double m = mean(v);
+        if (v.size() < 2 || m <= 0) return INFINITY;
+        return student_t(v.size() - 1) * stddev(v) / std::sqrt(v.size()) / m;
+    }
+
+    //! find row with the fewest threads of the same algorithm and input
+    const Row& base_row(const Row& r) const
+    {
+        const Row* base = &r;
+        for (size_t i = 0; i < m_rows.size(); ++i)
+        {
+            const Row& b = m_rows[i];
+            if (b.algo == r.algo && b.data == r.data &&
+                b.char_count == r.char_count && b.ok && b.times.size() &&
+                b.threads < base->threads)
+                base = &b;
+        }
+        return *base;
+    }
+
+    //! write all finished rows
+    bool write() const
+    {
+        std::ofstream f(m_path.c_str());
+        if (!f.good()) {
+            std::cout << "Error writing benchmark summary to " << m_path
+                      << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool json = m_path.size() >= 5 &&
+                    m_path.compare(m_path.size() - 5, 5, ".json") == 0;
+
+        if (json)
+            f << "[\n";
+        else
+            f << "algo,data,char_count,string_count,threads,repeats,status,"
+              << "median,min,mean,stddev,ci,speedup,efficiency\n";
+
+        for (size_t i = 0; i < m_rows.size(); ++i)
+        {
+            const Row& r = m_rows[i];
+            const Row& b = base_row(r);
+
+            double med = median(r.times);
+            double speedup = med > 0 ? median(b.times) / med : 0;
+            // sequential algorithms run with threads = 0
+            double eff = r.threads && b.threads
+                         ? speedup * b.threads / r.threads : speedup;
+            double ci = r.times.size() >= 2 ? r.ci : 0;
+
+            if (json)
+            {
+                f << "  { \"algo\": \"" << r.algo << "\""
+                  << ", \"data\": \"" << r.data << "\""
+                  << ", \"char_count\": " << r.char_count
+                  << ", \"string_count\": " << r.string_count
+                  << ", \"threads\": " << r.threads
+                  << ", \"repeats\": " << r.times.size()
+                  << ", \"status\": \"" << (r.ok ? "ok" : "failed") << "\""
+                  << ", \"median\": " << med
+                  << ", \"min\": " << (r.times.size() ? r.times[0] : 0)
+                  << ", \"mean\": " << (r.times.size() ? mean(r.times) : 0)
+                  << ", \"stddev\": " << stddev(r.times)
+                  << ", \"ci\": " << ci
+                  << ", \"speedup\": " << speedup
+                  << ", \"efficiency\": " << eff
+                  << " }" << (i + 1 < m_rows.size() ? "," : "") << "\n";
+            }
+            else
+            {
+                f << r.algo << ',' << r.data << ','
+                  << r.char_count << ',' << r.string_count << ','
+                  << r.threads << ',' << r.times.size() << ','
+                  << (r.ok ? "ok" : "failed") << ','
+                  << med << ',' << (r.times.size() ? r.times[0] : 0) << ','
+                  << (r.times.size() ? mean(r.times) : 0) << ','
+                  << stddev(r.times) << ',' << ci << ','
+                  << speedup << ',' << eff << '\n';
+            }
+        }
+
+        if (json) f << "]\n";
+
+        return f.good();
+    }
+
+public:
+    BenchSummary(const std::string& path, double ci_target,
+                 size_t min_repeats, size_t max_repeats)
+        : m_path(path), m_ci_target(ci_target),
+          m_min_repeats(std::max<size_t>(min_repeats, 2)),
+          m_max_repeats(std::max(max_repeats, m_min_repeats))
+    {
+        void* p = mmap(NULL, sizeof(Result), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        m_shared = (p != MAP_FAILED);
+        m_result = m_shared ? static_cast<Result*>(p) : new Result;
+        m_result->valid = false;
+    }
+
+    ~BenchSummary()
+    {
+        if (m_shared)
+            munmap(m_result, sizeof(Result));
+        else
+            delete m_result;
+    }
+
+    //! result slot of the current run
+    Result& result() { return *m_result; }
+
+    //! open a configuration of algorithm, input and thread count
+    void begin(const std::string& algo, const std::string& data,
+               size_t threads)
+    {
+        Row r;
+        r.algo = algo, r.data = data;
+        r.char_count = r.string_count = 0;
+        r.threads = threads;
+        r.runs = 0;
+        r.ci = INFINITY;
+        r.ok = true;
+        m_rows.push_back(r);
+        m_result->valid = false;
+    }
+
+    /*!
+     * Collect the result of the previous run, if any, and return whether to
+     * run the configuration again.
+     */
+    bool repeat()
+    {
+        Row& r = m_rows.back();
+
+        if (r.runs)
+        {
+            if (!m_result->valid) {
+                r.ok = false;
+                return false;
+            }
+            r.times.push_back(m_result->time);
+            r.string_count = m_result->string_count;
+            r.char_count = m_result->char_count;
+            r.ci = rel_ci(r.times);
+            m_result->valid = false;
+        }
+
+        if (r.times.size() >= m_min_repeats &&
+            (r.times.size() >= m_max_repeats || r.ci <= m_ci_target))
+            return false;
+
+        ++r.runs;
+        return true;
+    }
+
+    //! close the configuration and rewrite the output file
+    void end()
+    {
+        Row& r = m_rows.back();
+        std::sort(r.times.begin(), r.times.end());
+
+        std::cout << "Benchmark " << r.algo << " threads=" << r.threads
+                  << ": " << r.times.size() << " runs, median "
+                  << median(r.times) << " s, ci "
+                  << (r.times.size() >= 2 ? r.ci * 100 : 0) << "%"
+                  << (r.ok ? "" : ", failed") << std::endl;
+
+        write();
+    }
+};
+
+#endif // !PSS_SRC_TOOLS_BENCH_SUMMARY_HEADER
+
+/******************************************************************************/
@@ -23,108 +23,105 @@
 #ifndef PSS_SRC_TOOLS_CHECKER_HEADER
 #define PSS_SRC_TOOLS_CHECKER_HEADER
 
-class PermutationCheck
+/*!
+ * Arithmetic modulo a 64-bit odd modulus p in Montgomery form, with R = 2^64.
+ * mul(a,b) = a * b * R^-1 mod p requires only two 64x64 bit multiplications
+ * instead of a 128-bit division.
+ */
+class Montgomery64
 {
 private:
-    // polynomial evaluation of (z-0)*(z-1)*(z-2)...(z-(n-1)) mod (p)
-
-    mpz_class v;        // evaluation result
-    size_t iter;        // offset / iteration
+    uint64_t p;       // odd modulus
+    uint64_t pinv;    // p^-1 mod 2^64
+    uint64_t r2;      // R^2 mod p
 
 public:
-    PermutationCheck() : v(0), iter(0) { }
-
-    PermutationCheck(const membuffer<unsigned char*>& stringptr)
+    explicit Montgomery64(uint64_t _p) : p(_p)
     {
-        mpz_class p("18446744073709551557", 10); // largest prime < 2^64
-
-        for (iter = 1; iter < 100000; ++iter)
-        {
-            // use address after end of string area as evalution point
-            uint64_t z = (uint64_t)g_string_data + g_string_datasize + iter;
-            v = 1;
-
-            for (size_t i = 0; i < stringptr.size(); ++i)
-            {
-                assert(z >= (uint64_t)stringptr[i]);
-                v *= (z - (uint64_t)stringptr[i]);
-                v %= p;
-            }
-
-            //std::cout << "eval = " << v << "\n";
-
-            if (v != 0) break; // v != 0, thus a true check value
-
-            std::cout << "PermutationCheck: evaluation returned zero, repeating.\n";
-        }
+        // Newton iteration doubles the correct low bits of the inverse
+        pinv = p;
+        for (size_t i = 0; i < 5; ++i)
+            pinv *= 2 - p * pinv;
+        assert(p * pinv == 1);
+
+        uint64_t r = (0 - p) % p; // R mod p
+        r2 = static_cast<uint64_t>((unsigned __int128)r * r % p);
     }
 
-    bool check(const membuffer<unsigned char*>& stringptr) const
+    //! Montgomery reduction: return t * R^-1 mod p, requires t < p * R
+    uint64_t reduce(unsigned __int128 t) const
     {
-        mpz_class p("18446744073709551557", 10); // largest prime < 2^64
-
-        // use address after end of string area as evalution point
-        uint64_t z = (uint64_t)g_string_data + g_string_datasize + iter;
-        mpz_class w = 1;
+        uint64_t m = static_cast<uint64_t>(t) * pinv;
+        uint64_t thi = static_cast<uint64_t>(t >> 64);
+        uint64_t mhi = static_cast<uint64_t>(((unsigned __int128)m * p) >> 64);
+        // low words of t and m * p are equal, hence no borrow
+        return thi >= mhi ? thi - mhi : thi - mhi + p;
+    }
 
-        for (size_t i = 0; i < stringptr.size(); ++i)
-        {
-            assert(z >= (uint64_t)stringptr[i]);
-            w *= (z - (uint64_t)stringptr[i]);
-            w %= p;
-        }
+    //! return a * b * R^-1 mod p, requires a * b < p * R
+    uint64_t mul(uint64_t a, uint64_t b) const
+    {
+        return reduce((unsigned __int128)a * b);
+    }
 
-        return (v == w);
+    //! return a * b mod p
+    uint64_t mul_exact(uint64_t a, uint64_t b) const
+    {
+        return mul(a, mul(b, r2));
     }
 };
 
-class PermutationCheck64
+/*!
+ * Permutation check by polynomial evaluation of (z-s[0])*(z-s[1])*...*(z-s[n-1])
+ * mod p for the string pointers s[i], which is equal for all permutations.
+ * Each thread multiplies a range of factors in Montgomery form, the partial
+ * products are then combined exactly. Hence the result is the product times
+ * R^-n, independent of the number of threads.
+ */
+class PermutationCheck
 {
 private:
-    // polynomial evaluation of (z-0)*(z-1)*(z-2)...(z-(n-1)) mod (p)
-    static const uint64_t p = 4294967291; // largest prime < 2^32
-
     uint64_t v;                           // evaluation result
-    size_t iter;                          // offset / iteration
 
-public:
-    PermutationCheck64(const membuffer<unsigned char*>& stringptr)
+    //! evaluate polynomial at address after end of string area
+    static uint64_t evaluate(const membuffer<unsigned char*>& stringptr)
     {
-        for (iter = 1; iter < 100000; ++iter)
+        const Montgomery64 mont(18446744073709551557llu); // largest prime < 2^64
+        const uint64_t z = (uint64_t)g_string_data + g_string_datasize + 1;
+        const size_t n = stringptr.size();
+
+        uint64_t w = 1;
+
+#pragma omp parallel
         {
-            // use address after end of string area as evalution point
-            uint64_t z = (uint64_t)g_string_data + g_string_datasize + iter;
-            v = 1;
+            size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+            size_t begin = n * t / nthr, end = n * (t + 1) / nthr;
 
-            for (size_t i = 0; i < stringptr.size(); ++i)
+            // factors are < 2^48 as addresses are, thus none is zero mod p
+            uint64_t pw = 1;
+            for (size_t i = begin; i < end; ++i)
             {
-                assert(z >= (uint64_t)stringptr[i]);
-                v *= (z - (uint64_t)stringptr[i]);
-                v %= p;
+                assert(z > (uint64_t)stringptr[i]);
+                pw = mont.mul(pw, z - (uint64_t)stringptr[i]);
             }
 
-            //std::cout << "eval = " << v << "\n";
-
-            if (v != 0) return;
-
-            std::cout << "PermutationCheck: evaluation returned zero, repeating.\n";
+#pragma omp critical
+            w = mont.mul_exact(w, pw);
         }
+
+        return w;
     }
 
-    bool check(const membuffer<unsigned char*>& stringptr) const
-    {
-        // use address after end of string area as evalution point
-        uint64_t z = (uint64_t)g_string_data + g_string_datasize + iter;
-        uint64_t w = 1;
+public:
+    PermutationCheck() : v(0) { }
 
-        for (size_t i = 0; i < stringptr.size(); ++i)
-        {
-            assert(z >= (uint64_t)stringptr[i]);
-            w *= (z - (uint64_t)stringptr[i]);
-            w %= p;
-        }
+    PermutationCheck(const membuffer<unsigned char*>& stringptr)
+        : v(evaluate(stringptr))
+    { }
 
-        return (v == w);
+    bool check(const membuffer<unsigned char*>& stringptr) const
+    {
+        return (v == evaluate(stringptr));
     }
 };
 
@@ -138,44 +135,136 @@ bool check_sorted_order(const membuffer<unsigned char*>& stringptr, const Permut
         //return false;
     }
 
-    // check order naively
+    // check order in parallel, report first invalid pair
 
-    for (size_t i = 1; i < stringptr.size(); ++i)
+    size_t n = stringptr.size(), first_error = n;
+
+#pragma omp parallel for schedule(static) reduction(min:first_error)
+    for (size_t i = 1; i < n; ++i)
     {
-        if (strcmp((const char*)stringptr[i - 1], (const char*)stringptr[i]) > 0)
-        {
-            std::cout << "error: invalid order at pair " << i - 1 << " and " << i << "\n";
-            return false;
-        }
+        if (i < first_error &&
+            strcmp((const char*)stringptr[i - 1], (const char*)stringptr[i]) > 0)
+            first_error = i;
+    }
+
+    if (first_error != n)
+    {
+        std::cout << "error: invalid order at pair " << first_error - 1
+                  << " and " << first_error << "\n";
+        return false;
     }
 
     return true;
 }
 
-size_t calc_distinguishing_prefix(const membuffer<unsigned char*>& stringptr, size_t& lcpsum)
+//! check that equal strings are in their input order. The input string array
+//! is built by scanning the text, hence the input index of a string is
+//! ordered like its address.
+bool check_stable_order(const membuffer<unsigned char*>& stringptr)
 {
-    size_t D = 0;
-    size_t pdepth = 0;
+    size_t n = stringptr.size(), first_error = n;
+
+#pragma omp parallel for schedule(static) reduction(min:first_error)
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (i < first_error && stringptr[i - 1] > stringptr[i] &&
+            strcmp((const char*)stringptr[i - 1], (const char*)stringptr[i]) == 0)
+            first_error = i;
+    }
 
-    for (size_t i = 1; i < stringptr.size(); ++i)
+    if (first_error != n)
     {
-        size_t depth = 0;
-        while (stringptr[i - 1][depth] == stringptr[i][depth] &&
-               stringptr[i - 1][depth] != 0) ++depth;
+        std::cout << "error: equal strings not in input order at pair "
+                  << first_error - 1 << " and " << first_error << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+//! verify LCP array (and character cache if not NULL) of sorted strings in
+//! parallel, lcp[0] must equal expected_first_lcp.
+bool check_lcp_cache(const membuffer<unsigned char*>& stringptr,
+                     const uintptr_t* lcp, const uint8_t* charcache,
+                     uintptr_t expected_first_lcp)
+{
+    if (stringptr.size() && lcp[0] != expected_first_lcp)
+    {
+        std::cout << "error: lcp[0] = " << lcp[0]
+                  << " expected " << expected_first_lcp << "\n";
+        return false;
+    }
 
-        // depth == LCP of prev and this
-        lcpsum += depth;
+    size_t n = stringptr.size(), first_error = n;
+
+#pragma omp parallel for schedule(static) reduction(min:first_error)
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (i > first_error) continue;
 
-        // add distinguishing character
-        depth++;
+        const unsigned char* s1 = stringptr[i - 1], * s2 = stringptr[i];
 
-        if (pdepth < depth) {
-            D += depth - pdepth; // add extra distinguishing characters
+        uintptr_t h = 0;
+        while (s1[h] == s2[h] && s1[h] != 0) ++h;
+
+        if (h != lcp[i] || (charcache && charcache[i] != s2[h]))
+            first_error = i;
+    }
+
+    if (first_error != n)
+    {
+        std::cout << "error: invalid lcp or character cache at " << first_error
+                  << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+//! calculate the distinguishing prefix size and the LCP sum of the sorted
+//! strings. Each thread scans a range, for which the depth of the pair before
+//! its first one is recalculated.
+size_t calc_distinguishing_prefix(const membuffer<unsigned char*>& stringptr, size_t& lcpsum)
+{
+    // distinguishing characters of the pair (i-1,i) = LCP + 1
+    auto calc_depth =
+        [&stringptr](size_t i) {
+            size_t depth = 0;
+            while (stringptr[i - 1][depth] == stringptr[i][depth] &&
+                   stringptr[i - 1][depth] != 0) ++depth;
+            return depth;
+        };
+
+    size_t n = stringptr.size();
+    size_t D = 0, sum = 0;
+
+#pragma omp parallel reduction(+:D, sum)
+    {
+        size_t nthr = omp_get_num_threads(), t = omp_get_thread_num();
+        size_t begin = std::max<size_t>(1, n * t / nthr);
+        size_t end = std::max<size_t>(1, n * (t + 1) / nthr);
+
+        size_t pdepth = (begin >= 2 && begin < end) ? calc_depth(begin - 1) + 1 : 0;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            size_t depth = calc_depth(i);
+
+            // depth == LCP of prev and this
+            sum += depth;
+
+            // add distinguishing character
+            depth++;
+
+            if (pdepth < depth) {
+                D += depth - pdepth; // add extra distinguishing characters
+            }
+            D += depth;
+            pdepth = depth;
         }
-        D += depth;
-        pdepth = depth;
     }
 
+    lcpsum += sum;
     return D;
 }
 
@@ -130,12 +130,14 @@ public:
 
     virtual void run();         // implemented in main.cc
     void run_forked();          // implemented in main.cc
+    void run_repeated();        // implemented in main.cc
     void prepare_run();         // implemented in main.cc
 
     // implemented in main.cc
     void real_run(
         membuffer<uint8_t*>& stringptr,
-        std::vector<uintptr_t>& lcp, std::vector<uint8_t>& charcache);
+        std::vector<uintptr_t, hugepage::allocator<uintptr_t> >& lcp,
+        std::vector<uint8_t, hugepage::allocator<uint8_t> >& charcache);
 
     virtual bool is_parallel() const { return false; }
 
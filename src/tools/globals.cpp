@@ -33,4 +33,23 @@ size_t g_numa_nodes;
 // argument -M, --memory, see tools/input.h
 std::string gopt_memory_type;
 
+// argument --work-stealing, see tools/jobqueue.hpp
+bool gopt_work_stealing = false;
+
+// argument --steal-remote-min, smallest job taken from other NUMA nodes,
+// see tools/jobqueue.hpp
+size_t g_steal_remote_minsize = 64 * 1024;
+
+// allocate temporaries on huge pages, set by -M mmap_huge,
+// see tools/hugepage.hpp
+bool g_hugepage_alloc = false;
+
+// persistent thread pool used by JobQueue::loop(), if not NULL,
+// see tools/threadpool.hpp
+ThreadPool* g_thread_pool = NULL;
+
+// timeline of jobs run by the JobQueue, recorded if not NULL,
+// see tools/job_trace.hpp
+JobTrace* g_job_trace = NULL;
+
 /******************************************************************************/
@@ -40,6 +40,27 @@ extern std::string gopt_memory_type;
 
 extern size_t g_small_sort;
 
+// argument --work-stealing, see tools/jobqueue.hpp
+extern bool gopt_work_stealing;
+
+// argument --steal-remote-min, smallest job taken from other NUMA nodes,
+// see tools/jobqueue.hpp
+extern size_t g_steal_remote_minsize;
+
+// allocate temporaries on huge pages, set by -M mmap_huge,
+// see tools/hugepage.hpp
+extern bool g_hugepage_alloc;
+
+// persistent thread pool used by JobQueue::loop(), if not NULL,
+// see tools/threadpool.hpp
+class ThreadPool;
+extern ThreadPool* g_thread_pool;
+
+// timeline of jobs run by the JobQueue, recorded if not NULL,
+// see tools/job_trace.hpp
+class JobTrace;
+extern JobTrace* g_job_trace;
+
 #endif // !PSS_SRC_TOOLS_GLOBALS_HEADER
 
 /******************************************************************************/
@@ -0,0 +1,242 @@
+/*******************************************************************************
+ * src/tools/hugepage.hpp
+ *
+ * Allocation of large arrays on 2 MiB huge pages: explicit MAP_HUGETLB pages if
+ * the system has reserved some, otherwise transparent huge pages via madvise().
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_TOOLS_HUGEPAGE_HEADER
+#define PSS_SRC_TOOLS_HUGEPAGE_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+
+#include "globals.hpp"
+
+namespace hugepage {
+
+//! size of a huge page
+static const size_t page_size = 2 * 1024 * 1024;
+
+//! round size up to a multiple of the huge page size
+static inline size_t round_up(size_t size)
+{
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+//! how a mapping is backed
+enum mode_type { MODE_NONE, MODE_HUGETLB, MODE_THP };
+
+static inline const char * mode_name(mode_type mode)
+{
+    return mode == MODE_HUGETLB ? "hugetlb" : mode == MODE_THP ? "thp" : "none";
+}
+
+//! counters of huge pages mapped by allocate() since the last reset()
+struct Counters
+{
+    //! number of explicit huge pages, and of pages advised for THP
+    std::atomic<size_t> hugetlb_pages, thp_pages;
+};
+
+static inline Counters& counters()
+{
+    static Counters c;
+    return c;
+}
+
+static inline void reset_counters()
+{
+    counters().hugetlb_pages = 0;
+    counters().thp_pages = 0;
+}
+
+/*!
+ * Map size bytes (a multiple of page_size) of private anonymous memory on huge
+ * pages. Tries MAP_HUGETLB first, which fails if too few huge pages are
+ * reserved in /proc/sys/vm/nr_hugepages, and otherwise maps a 2 MiB aligned
+ * area and advises the kernel to back it by transparent huge pages. Returns
+ * NULL if no memory at all could be mapped.
+ */
+static inline void * map(size_t size, mode_type* mode = NULL)
+{
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+        if (mode) *mode = MODE_HUGETLB;
+        counters().hugetlb_pages += size / page_size;
+        return ptr;
+    }
+
+    // over-allocate to align the area to huge pages, and cut off the rest
+    char* area = (char*)mmap(NULL, size + page_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) return NULL;
+
+    char* begin = (char*)round_up((uintptr_t)area);
+    if (begin != area)
+        munmap(area, begin - area);
+    if (begin + size != area + size + page_size)
+        munmap(begin + size, area + size + page_size - (begin + size));
+
+    if (madvise(begin, size, MADV_HUGEPAGE) == 0) {
+        if (mode) *mode = MODE_THP;
+        counters().thp_pages += size / page_size;
+    }
+    else {
+        if (mode) *mode = MODE_NONE;
+    }
+
+    return begin;
+}
+
+//! unmap an area returned by map()
+static inline void unmap(void* ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+/*!
+ * Count the 2 MiB pages of [ptr,ptr+size) which are actually backed by huge
+ * pages, by reading the AnonHugePages and Private_Hugetlb fields of its
+ * mapping in /proc/self/smaps. The area must have been touched already.
+ */
+static inline size_t count_pages(void* ptr, size_t size)
+{
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+
+    uintptr_t addr = (uintptr_t)ptr;
+    bool inside = false;
+    size_t kib = 0, value;
+    char line[256];
+
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long begin, end;
+        if (sscanf(line, "%lx-%lx ", &begin, &end) == 2) {
+            // header line of next mapping
+            inside = (begin < addr + size && addr < end);
+        }
+        else if (inside &&
+                 (sscanf(line, "AnonHugePages: %zu kB", &value) == 1 ||
+                  sscanf(line, "Private_Hugetlb: %zu kB", &value) == 1 ||
+                  sscanf(line, "Shared_Hugetlb: %zu kB", &value) == 1)) {
+            kib += value;
+        }
+    }
+
+    fclose(f);
+    return kib * 1024 / page_size;
+}
+
+//! header stored before each block returned by allocate()
+struct Header
+{
+    //! size of the mapping, or zero if allocated by malloc()
+    size_t mapped;
+    //! pad to keep blocks aligned to cache lines
+    char pad[64 - sizeof(size_t)];
+};
+
+/*!
+ * Allocate bytes of memory, on huge pages if g_hugepage_alloc is set (-M
+ * mmap_huge) and the block spans at least one huge page, otherwise with
+ * malloc(). Must be freed with deallocate().
+ */
+static inline void * allocate(size_t bytes)
+{
+    Header* h;
+    if (g_hugepage_alloc && bytes >= page_size)
+    {
+        size_t mapped = round_up(bytes + sizeof(Header));
+        h = (Header*)map(mapped);
+        if (!h) throw std::bad_alloc();
+        h->mapped = mapped;
+    }
+    else
+    {
+        h = (Header*)malloc(bytes + sizeof(Header));
+        if (!h) throw std::bad_alloc();
+        h->mapped = 0;
+    }
+    return h + 1;
+}
+
+//! free a block returned by allocate(), ignores NULL.
+static inline void deallocate(void* ptr)
+{
+    if (!ptr) return;
+
+    Header* h = (Header*)ptr - 1;
+    if (h->mapped)
+        unmap(h, h->mapped);
+    else
+        free(h);
+}
+
+//! allocate an array of n uninitialized items of a trivial type
+template <typename Type>
+static inline Type * allocate_array(size_t n)
+{
+    return static_cast<Type*>(allocate(n * sizeof(Type)));
+}
+
+//! STL allocator using allocate() and deallocate()
+template <typename Type>
+class allocator
+{
+public:
+    typedef Type value_type;
+
+    allocator() noexcept { }
+
+    template <typename Other>
+    allocator(const allocator<Other>&) noexcept { }
+
+    Type * allocate(size_t n)
+    {
+        return allocate_array<Type>(n);
+    }
+
+    void deallocate(Type* ptr, size_t)
+    {
+        hugepage::deallocate(ptr);
+    }
+
+    template <typename Other>
+    bool operator == (const allocator<Other>&) const noexcept
+    { return true; }
+
+    template <typename Other>
+    bool operator != (const allocator<Other>&) const noexcept
+    { return false; }
+};
+
+} // namespace hugepage
+
+#endif // !PSS_SRC_TOOLS_HUGEPAGE_HEADER
+
+/******************************************************************************/
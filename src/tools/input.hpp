@@ -23,7 +23,14 @@
 #ifndef PSS_SRC_TOOLS_INPUT_HEADER
 #define PSS_SRC_TOOLS_INPUT_HEADER
 
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <omp.h>
+
 #include "globals.hpp"
+#include "hugepage.hpp"
 
 namespace input {
 
@@ -35,6 +42,8 @@ bool check_memory_type(const std::string& memtype)
     if (memtype == "mmap_interleave") return true;
     if (memtype == "mmap_node0") return true;
     if (memtype == "mmap_segment") return true;
+    if (memtype == "mmap_file") return true;
+    if (memtype == "mmap_huge") return true;
 
     std::cout << "Following --memory types are available:" << std::endl
               << "  malloc           use plain malloc() call (default)" << std::endl
@@ -42,6 +51,8 @@ bool check_memory_type(const std::string& memtype)
               << "  mmap_interleave  use libnuma to interleave onto nodes" << std::endl
               << "  mmap_node0       pin memory to numa node 0" << std::endl
               << "  mmap_segment     segment characters equally onto all numa nodes" << std::endl
+              << "  mmap_file        map plain input files directly (private copy-on-write)" << std::endl
+              << "  mmap_huge        use huge pages, also for string pointers and temporaries" << std::endl
     ;
 
     /*
@@ -110,7 +121,9 @@ void free_stringdata()
     if (gopt_memory_type == "mmap" ||
         gopt_memory_type == "mmap_interleave" ||
         gopt_memory_type == "mmap_node0" ||
-        gopt_memory_type == "mmap_segment")
+        gopt_memory_type == "mmap_segment" ||
+        gopt_memory_type == "mmap_file" ||
+        gopt_memory_type == "mmap_huge")
     {
         if (munmap(g_string_databuff, g_string_buffsize)) {
             std::cout << "Error unmapping string data memory: " << strerror(errno) << std::endl;
@@ -137,7 +150,36 @@ char * allocate_stringdata(size_t size, const std::string& path)
     std::cout << "Allocating " << size << " bytes in RAM, reading " << path << std::endl;
 
     char* stringdata;
-    if (gopt_memory_type == "mmap" ||
+    if (gopt_memory_type == "mmap_file")
+    {
+        // generated or decompressed input: private anonymous memory, such
+        // that free_stringdata() can munmap() all mmap_file buffers.
+        stringdata = (char*)mmap(
+            NULL, g_string_buffsize,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (stringdata == MAP_FAILED) {
+            std::cout << "Error allocating memory: " << strerror(errno) << std::endl;
+            return NULL;
+        }
+    }
+    else if (gopt_memory_type == "mmap_huge")
+    {
+        // private mapping on huge pages, which are copied on write after
+        // fork(), but the algorithms only read the characters.
+        g_string_buffsize = hugepage::round_up(g_string_buffsize);
+
+        hugepage::mode_type mode;
+        stringdata = (char*)hugepage::map(g_string_buffsize, &mode);
+        if (!stringdata) {
+            std::cout << "Error allocating memory: " << strerror(errno) << std::endl;
+            return NULL;
+        }
+
+        std::cout << "Mapped " << g_string_buffsize / hugepage::page_size
+                  << " huge pages using " << hugepage::mode_name(mode)
+                  << std::endl;
+    }
+    else if (gopt_memory_type == "mmap" ||
         gopt_memory_type == "mmap_interleave" ||
         gopt_memory_type == "mmap_node0" ||
         gopt_memory_type == "mmap_segment")
@@ -302,6 +344,154 @@ bool load_plain(const std::string& path)
     return true;
 }
 
+/// Map a plain file containing newline terminated strings directly into
+/// memory (-M mmap_file). The file is mapped MAP_PRIVATE, hence replacing '\n'
+/// -> '\0' only creates private copies of the touched pages and the file
+/// remains unchanged. Newlines are replaced by all threads in parallel.
+bool load_mmap_file(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Cannot open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    off_t filesize = lseek(fd, 0, SEEK_END);
+    if (filesize < 0) {
+        std::cout << "Cannot seek in " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+
+    size_t size = filesize;
+
+    // apply size limit
+    if (gopt_inputsize && size > gopt_inputsize)
+        size = gopt_inputsize;
+
+    if (size == 0) {
+        std::cout << "Cannot map empty file " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    free_stringdata();
+
+    std::cout << "Mapping " << size << " bytes of " << path << std::endl;
+
+    // reserve anonymous zero pages: one page in front, the file's pages, and
+    // one page behind. The file is mapped over the middle part, such that the
+    // terminators before and after the characters are zeros of the anonymous
+    // mapping.
+    size_t pagesize = sysconf(_SC_PAGE_SIZE);
+    size_t mapsize = (size + pagesize - 1) / pagesize * pagesize;
+
+    g_string_buffsize = pagesize + mapsize + pagesize;
+
+    char* buff = (char*)mmap(
+        NULL, g_string_buffsize,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buff == MAP_FAILED) {
+        std::cout << "Error allocating memory: " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+
+    char* stringdata = (char*)mmap(
+        buff + pagesize, mapsize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0);
+    if (stringdata == MAP_FAILED) {
+        std::cout << "Cannot map " << path << ": " << strerror(errno) << std::endl;
+        munmap(buff, g_string_buffsize);
+        close(fd);
+        return false;
+    }
+
+    close(fd);
+
+    g_string_databuff = buff;
+    g_string_data = stringdata;
+    g_string_datasize = size;
+
+    if (!gopt_suffixsort)
+    {
+        // replace '\n' -> '\0' and count string starts in parallel
+        size_t count = 1;
+
+#pragma omp parallel for schedule(static) reduction(+:count)
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (stringdata[i] == '\n' || stringdata[i] == 0) {
+                stringdata[i] = 0;
+                if (i + 1 < size) count++;
+            }
+        }
+
+        g_string_count = count;
+    }
+    else {
+        g_string_count = size;
+    }
+
+    // force terminatation of last string
+    stringdata[size - 1] = 0;
+
+    // add more termination, these are either inside the file's last page or
+    // in the anonymous page behind it
+    for (size_t i = size; i < size + 9; ++i)
+        stringdata[i] = 0;
+
+    g_dataname = strip_datapath(path);
+
+    return true;
+}
+
+/// Fill stringptr with pointers to the g_string_count null-terminated strings
+/// in g_string_data in parallel: each thread counts the string starts in a
+/// range of characters, an exclusive prefix sum over the counts yields the
+/// first output index of each range, and a second pass writes the pointers.
+template <typename String>
+void parallel_string_starts(String* stringptr)
+{
+    const char* data = g_string_data;
+    size_t size = g_string_datasize;
+
+    int nthr = omp_get_max_threads();
+    std::vector<size_t> offset(nthr + 1, 0);
+
+#pragma omp parallel for schedule(static, 1)
+    for (int p = 0; p < nthr; ++p)
+    {
+        size_t begin = size * p / nthr, end = size * (p + 1) / nthr;
+
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (i == 0 || data[i - 1] == 0) ++count;
+        }
+        offset[p + 1] = count;
+    }
+
+    for (int p = 0; p < nthr; ++p)
+        offset[p + 1] += offset[p];
+
+#pragma omp parallel for schedule(static, 1)
+    for (int p = 0; p < nthr; ++p)
+    {
+        size_t begin = size * p / nthr, end = size * (p + 1) / nthr;
+
+        size_t j = offset[p];
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (i == 0 || data[i - 1] == 0)
+                stringptr[j++] = (String)(data + i);
+        }
+        assert(j == offset[p + 1]);
+    }
+
+    assert(offset[nthr] == g_string_count);
+}
+
 /// Read a compressed file containing newline terminated strings
 bool load_compressed(const std::string& path)
 {
@@ -467,6 +657,46 @@ bool generate_random(const std::string& path, const std::string& letters)
     return true;
 }
 
+/// Generate artificial random strings of fixed length with given letter set.
+bool generate_fixed(const std::string& path, const std::string& letters,
+                    size_t length)
+{
+    if (!gopt_inputsize) {
+        std::cout << "Random input size must be specified via '-s <size>'" << std::endl;
+        return false;
+    }
+
+    // only complete strings
+    size_t size = gopt_inputsize / (length + 1) * (length + 1);
+    if (!size) size = length + 1;
+
+    // create memory area
+    char* stringdata = allocate_stringdata(size, path);
+
+    if (!stringdata) {
+        return false;
+    }
+
+    g_string_count = size / (length + 1);
+    LCGRandom rng(1234567);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (i % (length + 1) == length) // end of string
+            stringdata[i] = 0;
+        else
+            stringdata[i] = letters[(rng() / 100) % letters.size()];
+    }
+
+    if (gopt_suffixsort) g_string_count = size;
+
+    // add more termination
+    for (size_t i = size; i < size + 9; ++i)
+        stringdata[i] = 0;
+
+    return true;
+}
+
 /// Generate artificial random input in exactly the same way as sinha's
 /// randomstrings.c does.
 bool generate_sinha_randomASCII()
@@ -543,6 +773,15 @@ bool load_artifical(const std::string& path)
     else if (path == "randomASCII") {
         return generate_sinha_randomASCII();
     }
+    else if (path == "fixed12") {
+        return generate_fixed("fixed12", "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz", 12);
+    }
+    else if (path == "fixed16")
+    {
+        std::string letters(255, 0);
+        for (int i = 0; i < 255; ++i) letters[i] = (char)(i + 1);
+        return generate_fixed("fixed16", letters, 16);
+    }
     else
         return false;
 }
@@ -556,6 +795,7 @@ bool load(const std::string& path)
         g_dataname = path;
     }
     else if (load_compressed(path)) { }
+    else if (gopt_memory_type == "mmap_file" && load_mmap_file(path)) { }
     else if (load_plain(path)) { }
     else {
         return false;
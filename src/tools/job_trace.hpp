@@ -0,0 +1,229 @@
+/*******************************************************************************
+ * src/tools/job_trace.hpp
+ *
+ * Timeline of all jobs run by the JobQueue, recorded into per-thread ring
+ * buffers and written as Chrome trace JSON (chrome://tracing, Perfetto).
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_TOOLS_JOB_TRACE_HEADER
+#define PSS_SRC_TOOLS_JOB_TRACE_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ * Recorder of job events. Each thread writes into its own ring buffer without
+ * any synchronization, it registers the buffer under a mutex only on its first
+ * event. When a buffer is full, the oldest events are overwritten. The buffers
+ * must only be read by write_json() after all jobs finished, i.e. after
+ * JobQueue::loop() returned.
+ *
+ * Events are grouped by runs, which are shown as separate processes labeled
+ * with the run's name, e.g. the algorithm.
+ */
+class JobTrace
+{
+public:
+    //! one executed job
+    struct Event
+    {
+        //! start and end time in nanoseconds since the trace was created
+        uint64_t begin, end;
+        //! job type
+        const char* name;
+        //! subproblem size, e.g. number of strings
+        size_t size;
+        //! run index
+        unsigned run;
+    };
+
+    //! per-thread ring buffer of events
+    struct Buffer
+    {
+        //! thread number in the trace
+        unsigned tid;
+        //! ring of events, total number of events recorded
+        std::vector<Event> ring;
+        size_t count;
+    };
+
+protected:
+    //! events per thread buffer
+    size_t m_capacity;
+
+    //! time origin
+    std::chrono::steady_clock::time_point m_origin;
+
+    //! registered thread buffers
+    std::vector<Buffer*> m_buffers;
+    std::mutex m_mutex;
+
+    //! names of runs, current run is the last
+    std::vector<std::string> m_runs;
+
+    //! buffer of the calling thread in the trace with the given serial
+    static Buffer*& tls_buffer(size_t serial)
+    {
+        static thread_local Buffer* buffer = NULL;
+        static thread_local size_t buffer_serial = 0;
+        if (buffer_serial != serial) buffer = NULL, buffer_serial = serial;
+        return buffer;
+    }
+
+    //! unique number of this trace object, for tls_buffer()
+    size_t m_serial;
+
+    static size_t next_serial()
+    {
+        static std::atomic<size_t> serial(0);
+        return ++serial;
+    }
+
+    //! register a new buffer for the calling thread
+    Buffer* register_buffer()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Buffer* b = new Buffer;
+        b->tid = m_buffers.size();
+        b->ring.resize(m_capacity);
+        b->count = 0;
+        m_buffers.push_back(b);
+        return b;
+    }
+
+    //! write string escaped for JSON
+    static void write_escaped(std::ostream& os, const std::string& s)
+    {
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '"' || s[i] == '\\') os << '\\';
+            os << s[i];
+        }
+    }
+
+public:
+    //! create trace with capacity events per thread
+    explicit JobTrace(size_t capacity = 1024 * 1024)
+        : m_capacity(capacity),
+          m_origin(std::chrono::steady_clock::now()),
+          m_runs(1, "run"),
+          m_serial(next_serial())
+    { }
+
+    ~JobTrace()
+    {
+        for (size_t i = 0; i < m_buffers.size(); ++i)
+            delete m_buffers[i];
+    }
+
+    //! current time in nanoseconds since creation
+    uint64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_origin).count();
+    }
+
+    //! start a new run, following events are grouped under name
+    void begin_run(const std::string& name)
+    {
+        m_runs.push_back(name);
+    }
+
+    //! record a job event of the calling thread
+    void record(uint64_t begin, uint64_t end, const char* name, size_t size)
+    {
+        Buffer*& b = tls_buffer(m_serial);
+        if (!b) b = register_buffer();
+
+        Event& e = b->ring[b->count++ % m_capacity];
+        e.begin = begin, e.end = end;
+        e.name = name, e.size = size;
+        e.run = m_runs.size() - 1;
+    }
+
+    //! total number of events lost by overwriting
+    size_t dropped() const
+    {
+        size_t d = 0;
+        for (size_t i = 0; i < m_buffers.size(); ++i) {
+            if (m_buffers[i]->count > m_capacity)
+                d += m_buffers[i]->count - m_capacity;
+        }
+        return d;
+    }
+
+    //! write all recorded events as Chrome trace JSON, returns false if the
+    //! file could not be written.
+    bool write_json(const std::string& path) const
+    {
+        std::ofstream os(path.c_str());
+        if (!os.good()) {
+            std::cout << "JobTrace: could not open " << path << std::endl;
+            return false;
+        }
+
+        os << "{\"traceEvents\":[\n";
+        bool first = true;
+
+        // label runs as processes and threads
+        for (size_t r = 0; r < m_runs.size(); ++r)
+        {
+            os << (first ? "" : ",\n")
+               << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << r
+               << ",\"args\":{\"name\":\"";
+            write_escaped(os, m_runs[r]);
+            os << "\"}}";
+            first = false;
+        }
+
+        for (size_t i = 0; i < m_buffers.size(); ++i)
+        {
+            const Buffer& b = *m_buffers[i];
+
+            size_t n = std::min(b.count, m_capacity);
+            for (size_t j = b.count - n; j < b.count; ++j)
+            {
+                const Event& e = b.ring[j % m_capacity];
+
+                // timestamps in microseconds
+                os << ",\n{\"name\":\"" << e.name
+                   << "\",\"cat\":\"job\",\"ph\":\"X\",\"pid\":" << e.run
+                   << ",\"tid\":" << b.tid
+                   << ",\"ts\":" << e.begin / 1000 << '.'
+                   << (e.begin / 100) % 10
+                   << ",\"dur\":" << (e.end - e.begin) / 1000 << '.'
+                   << ((e.end - e.begin) / 100) % 10
+                   << ",\"args\":{\"size\":" << e.size << "}}";
+            }
+        }
+
+        os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        return os.good();
+    }
+};
+
+#endif // !PSS_SRC_TOOLS_JOB_TRACE_HEADER
+
+/******************************************************************************/
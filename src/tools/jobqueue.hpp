@@ -25,6 +25,8 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <vector>
 
 #include <omp.h>
 #include <numa.h>
@@ -43,6 +45,9 @@
 #include "../tools/timer.hpp"
 #include "../tools/timer_array.hpp"
 #include "../tools/globals.hpp"
+#include "../tools/lockfree.hpp"
+#include "../tools/threadpool.hpp"
+#include "../tools/job_trace.hpp"
 
 namespace jobqueue {
 
@@ -50,6 +55,17 @@ static const bool debug_queue = false;
 
 // ****************************************************************************
 // *** Job and JobQueue system with lock-free queue and OpenMP threads
+//
+// By default all jobs are pushed into one central lock-free queue. With
+// gopt_work_stealing each thread additionally owns a Chase-Lev deque: jobs
+// created while running a job are pushed onto the local deque, popped LIFO by
+// the owner, and stolen FIFO by idle threads. The central queue then only
+// holds jobs enqueued from outside the worker threads, e.g. the initial job.
+//
+// Idle threads steal hierarchically: first from the deque of their sibling
+// thread, which is pinned to the adjacent cpu, then from all deques of their
+// JobQueue (one NUMA node in a NumaJobQueueGroup), and finally big jobs from
+// busy JobQueues of other NUMA nodes, nearest first.
 
 template <typename CookieType>
 class JobT
@@ -64,6 +80,15 @@ public:
     /// virtual function that is called by the JobQueue, delete object if run()
     /// returns true.
     virtual bool run(cookie_type& cookie) = 0;
+
+    /// job type shown in the JobTrace timeline
+    virtual const char * trace_name() const
+    { return "Job"; }
+
+    /// subproblem size shown in the JobTrace timeline, jobs of other NUMA
+    /// nodes are only stolen if it is at least g_steal_remote_minsize.
+    virtual size_t trace_size() const
+    { return 0; }
 };
 
 template <typename CookieType>
@@ -85,16 +110,35 @@ public:
     /// typedef of JobQueueGroup
     typedef JobQueueGroupType<CookieType> jobqueuegroup_type;
 
+    /// typedef of per-thread work-stealing deque
+    typedef lockfree::chase_lev_deque<job_type*> deque_type;
+
 private:
     /// lock-free data structure containing pointers to Job objects.
     tbb::concurrent_queue<job_type*> m_queue;
 
+    //! whether to use per-thread work-stealing deques
+    bool m_work_stealing;
+
+    //! per-thread work-stealing deques, indexed by OpenMP thread number
+    std::vector<deque_type*> m_deques;
+
+    //! JobQueue the current thread is working for, and its deque index
+    static thread_local JobQueueT* s_thread_queue;
+    static thread_local unsigned s_thread_id;
+
     //! number of threads working on queue
     unsigned m_numthrs;
 
     /// number of threads idle
     std::atomic<unsigned int> m_idle_count;
 
+    //! number of threads of other JobQueues currently running our jobs
+    std::atomic<unsigned int> m_assisting;
+
+    //! number of jobs stolen from the sibling's deque and from other deques
+    std::atomic<size_t> m_steals_sibling, m_steals_node;
+
     //! reference to the cookie of this JobQueue
     cookie_type& m_cookie;
 
@@ -123,24 +167,139 @@ public:
     JobQueueT(cookie_type& cookie,
               jobqueuegroup_type* group)
         : m_queue(),
+          m_work_stealing(gopt_work_stealing),
           m_numthrs(0),
           m_idle_count(0),
+          m_assisting(0),
+          m_steals_sibling(0), m_steals_node(0),
           m_cookie(cookie),
           m_group(group),
           m_logger("jobqueue.txt", 0.005, 10000),
           m_work_logger("worker_count.txt", 0.005, 10000),
           m_timers(2)
-    { }
+    {
+        if (m_work_stealing)
+        {
+            // thread numbers beyond this fall back to the central queue
+            m_deques.resize(omp_get_max_threads());
+            for (size_t i = 0; i < m_deques.size(); ++i)
+                m_deques[i] = new deque_type(256);
+        }
+    }
+
+    ~JobQueueT()
+    {
+        for (size_t i = 0; i < m_deques.size(); ++i)
+            delete m_deques[i];
+    }
 
     bool has_idle() const
     {
         return (m_idle_count.load(std::memory_order_relaxed) != 0);
     }
 
+    //! true if all threads are idle and no other JobQueue runs our jobs
+    bool is_finished() const
+    {
+        return (m_idle_count == m_numthrs && m_assisting == 0);
+    }
+
+    //! number of jobs stolen from the deque of the sibling thread
+    size_t steals_sibling() const
+    {
+        return m_steals_sibling;
+    }
+
+    //! number of jobs stolen from the other deques of this JobQueue
+    size_t steals_node() const
+    {
+        return m_steals_node;
+    }
+
+    //! true if the calling thread owns a deque of this JobQueue
+    bool is_worker() const
+    {
+        return (s_thread_queue == this);
+    }
+
     void enqueue(job_type* job)
     {
-        m_queue.push(job);
-        m_logger << m_queue.unsafe_size();
+        if (m_work_stealing && is_worker())
+            m_deques[s_thread_id]->push(job);
+        else
+            m_queue.push(job);
+
+        m_logger << size();
+    }
+
+    //! approximate number of queued jobs
+    size_t size() const
+    {
+        size_t size = m_queue.unsafe_size();
+        for (size_t i = 0; i < m_deques.size(); ++i)
+            size += m_deques[i]->size();
+        return size;
+    }
+
+    //! fetch a job: from the own deque (LIFO), then from the central queue,
+    //! and finally steal from other threads' deques (FIFO).
+    bool try_pop(job_type*& job)
+    {
+        if (!m_work_stealing)
+            return m_queue.try_pop(job);
+
+        if (is_worker() && m_deques[s_thread_id]->pop(job))
+            return true;
+
+        if (m_queue.try_pop(job))
+            return true;
+
+        return try_steal(job);
+    }
+
+    //! steal a job from the top of another thread's deque: first from the
+    //! sibling thread (id ^ 1), then from the others round-robin.
+    bool try_steal(job_type*& job)
+    {
+        size_t n = m_deques.size();
+
+        if (!is_worker())
+        {
+            // thread of another JobQueue, counted by NumaJobQueueGroup
+            for (size_t id = 0; id < n; ++id) {
+                if (m_deques[id]->steal(job)) return true;
+            }
+            return false;
+        }
+
+        size_t sibling = s_thread_id ^ 1;
+
+        if (sibling < n && m_deques[sibling]->steal(job))
+        {
+            LOGC(debug_queue)
+                << "Queue" << m_id << " stole job from sibling " << sibling;
+            ++m_steals_sibling;
+            return true;
+        }
+
+        // go through deques round-robin starting after own
+        size_t id = s_thread_id + 1;
+
+        for (size_t i = 0; i < n - 1; ++i, ++id)
+        {
+            if (id >= n) id = 0;
+            if (id == sibling) continue;
+
+            if (m_deques[id]->steal(job))
+            {
+                LOGC(debug_queue)
+                    << "Queue" << m_id << " stole job from thread " << id;
+                ++m_steals_node;
+                return true;
+            }
+        }
+
+        return false;
     }
 
     void set_id(unsigned id)
@@ -148,27 +307,103 @@ public:
         m_id = id;
     }
 
-    //! try to run one jobs from the queue, returns false if queue is finished,
-    //! true if ran jobs or queue not finished.
+    //! run a job and delete it if requested, record it in g_job_trace if set
+    void run_job(job_type* job)
+    {
+        if (!g_job_trace)
+        {
+            if (job->run(m_cookie))
+                delete job;
+            return;
+        }
+
+        // the job may delete itself in run()
+        const char* name = job->trace_name();
+        size_t size = job->trace_size();
+
+        uint64_t begin = g_job_trace->now();
+        if (job->run(m_cookie))
+            delete job;
+        g_job_trace->record(begin, g_job_trace->now(), name, size);
+    }
+
+    //! try to run one jobs from the queue on a thread of another JobQueue,
+    //! returns false if queue is finished, true if ran jobs or queue not
+    //! finished.
     bool try_run()
     {
         job_type* job = NULL;
 
-        if (!m_queue.try_pop(job))
-            return (m_idle_count != m_numthrs);
+        // keep our threads from terminating while running the job, as it may
+        // enqueue further jobs.
+        ++m_assisting;
 
-        m_logger << m_queue.unsafe_size();
+        bool ran = try_pop(job);
+        if (ran) {
+            m_logger << size();
+            run_job(job);
+        }
 
-        if (job->run(m_cookie))
-            delete job;
+        --m_assisting;
 
-        return true;
+        return ran || !is_finished();
+    }
+
+    //! try to run one job of at least min_size on a thread of another JobQueue
+    //! while this one is busy, i.e. none of its threads is idle. Smaller jobs
+    //! are put back. Returns true if a job was run.
+    bool try_run_remote(size_t min_size)
+    {
+        if (has_idle()) return false;
+
+        job_type* job = NULL;
+        bool ran = false;
+
+        ++m_assisting;
+
+        if (try_pop(job))
+        {
+            if (job->trace_size() >= min_size) {
+                m_logger << size();
+                run_job(job);
+                ran = true;
+            }
+            else {
+                m_queue.push(job);
+            }
+        }
+
+        --m_assisting;
+
+        return ran;
     }
 
     inline void executeThreadWork()
+    {
+        executeThreadWork(ThreadPool::thread_num(), omp_get_num_threads());
+    }
+
+    inline void executeThreadWork(unsigned tid, unsigned numthrs)
+    {
+        // register calling thread as owner of a deque, remember the previous
+        // owner if this thread is assisting from another JobQueue
+        JobQueueT* prev_queue = s_thread_queue;
+        unsigned prev_id = s_thread_id;
+
+        if (m_work_stealing && tid < m_deques.size())
+            s_thread_queue = this, s_thread_id = tid;
+        else
+            s_thread_queue = NULL;
+
+        executeThreadWorkLoop(numthrs);
+
+        s_thread_queue = prev_queue, s_thread_id = prev_id;
+    }
+
+    inline void executeThreadWorkLoop(unsigned numthrs)
     {
         job_type* job = NULL;
-        m_numthrs = omp_get_num_threads();
+        m_numthrs = numthrs;
 
         m_timers.change(TM_WORK);
         m_logger.start();
@@ -176,12 +411,11 @@ public:
 
         while (true)
         {
-            while (m_queue.try_pop(job))
+            while (try_pop(job))
             {
-                m_logger << m_queue.unsafe_size();
+                m_logger << size();
 
-                if (job->run(m_cookie))
-                    delete job;
+                run_job(job);
             }
 
             LOGC(debug_queue) << "Queue" << m_id << " is empty";
@@ -190,17 +424,22 @@ public:
             m_timers.change(TM_IDLE);
             ++m_idle_count;
 
-            m_logger << m_queue.unsafe_size();
+            m_logger << size();
             m_work_logger << (m_numthrs - m_idle_count);
 
-            while (!m_queue.try_pop(job))
+            while (!try_pop(job))
             {
                 LOGC(debug_queue)
                     << "Idle thread - m_idle_count: " << m_idle_count;
 
-                if ( //!m_group->assist(m_id) &&
-                    m_idle_count == m_numthrs)
+                // take big jobs from busy JobQueues of other NUMA nodes
+                if (m_group->steal_remote(m_id)) continue;
+
+                if (is_finished())
                 {
+                    // jobs may have been enqueued by assisting threads
+                    if (try_pop(job)) break;
+
                     // assist other JobQueues before terminating.
                     while (m_group->assist(m_id)) { }
                     return;
@@ -211,12 +450,24 @@ public:
             m_timers.change(TM_WORK);
             --m_idle_count;
 
-            m_logger << m_queue.unsafe_size();
+            m_logger << size();
             m_work_logger << (m_numthrs - m_idle_count);
 
-            if (job->run(m_cookie))
-                delete job;
+            run_job(job);
+        }
+    }
+
+    //! thread body of loop()
+    void loopThread(unsigned tid, unsigned numthrs)
+    {
+        if (gopt_memory_type == "mmap_node0")
+        {
+            // tie thread to first NUMA node
+            numa_run_on_node(0);
+            numa_set_preferred(0);
         }
+
+        executeThreadWork(tid, numthrs);
     }
 
     void loop()
@@ -224,21 +475,33 @@ public:
         m_timers.start(omp_get_max_threads());
         m_idle_count = 0;
 
-#pragma omp parallel
-        {
-            if (gopt_memory_type == "mmap_node0")
-            {
-                // tie thread to first NUMA node
-                numa_run_on_node(0);
-                numa_set_preferred(0);
-            }
+        // run on the persistent thread pool if there is one and it is idle,
+        // otherwise start an OpenMP team as usual.
+        ThreadPool* pool = ThreadPool::bound() ? ThreadPool::bound() : g_thread_pool;
 
-            executeThreadWork();
-        }   // end omp parallel
+        bool pooled =
+            pool && !omp_in_parallel() &&
+            pool->try_run(
+                omp_get_max_threads(),
+                [this](size_t tid, size_t numthrs) {
+                    loopThread(tid, numthrs);
+                });
+
+        if (!pooled)
+        {
+#pragma omp parallel
+            loopThread(omp_get_thread_num(), omp_get_num_threads());
+        }
 
         m_timers.stop();
 
-        assert(m_queue.unsafe_size() == 0);
+        if (m_work_stealing)
+        {
+            g_stats >> "steals_sibling" << m_steals_sibling
+                >> "steals_node" << m_steals_node;
+        }
+
+        assert(size() == 0);
     }
 
     void numaLoop(int numaNode, int numberOfThreads)
@@ -256,10 +519,20 @@ public:
 
         m_timers.stop();
 
-        assert(m_queue.unsafe_size() == 0);
+        assert(size() == 0);
     }
 };
 
+template <typename CookieType,
+          template <typename> class JobQueueGroupType>
+thread_local JobQueueT<CookieType, JobQueueGroupType>*
+JobQueueT<CookieType, JobQueueGroupType>::s_thread_queue = NULL;
+
+template <typename CookieType,
+          template <typename> class JobQueueGroupType>
+thread_local unsigned
+JobQueueT<CookieType, JobQueueGroupType>::s_thread_id = 0;
+
 //! Define no-operation JobQueueGroup for "standard" JobQueue
 template <typename CookieType>
 class DefaultJobQueueGroup
@@ -276,6 +549,11 @@ public:
     {
         return false;
     }
+
+    static inline bool steal_remote(unsigned)
+    {
+        return false;
+    }
 };
 
 //! Define NumaJobQueueGroup to group JobQueue which assist each other when idle.
@@ -293,7 +571,40 @@ protected:
     //! List of managed JobQueues.
     std::vector<jobqueue_type*> m_queues;
 
+    //! Other JobQueues of each JobQueue, ordered by NUMA distance.
+    std::vector<std::vector<unsigned> > m_victims;
+
+    //! number of jobs stolen from JobQueues of other NUMA nodes
+    std::atomic<size_t> m_steals_remote;
+
+    //! Order other JobQueues of each JobQueue by distance of their NUMA
+    //! nodes, ties are broken round-robin starting after own.
+    void calc_victims(int realNumaNodes)
+    {
+        unsigned n = m_queues.size();
+        m_victims.resize(n);
+
+        for (unsigned k = 0; k < n; ++k)
+        {
+            std::vector<unsigned>& v = m_victims[k];
+            v.clear();
+            for (unsigned i = 1; i < n; ++i)
+                v.push_back((k + i) % n);
+
+            int node = k % realNumaNodes;
+            std::stable_sort(
+                v.begin(), v.end(),
+                [node, realNumaNodes](unsigned a, unsigned b) {
+                    return numa_distance(node, a % realNumaNodes)
+                    < numa_distance(node, b % realNumaNodes);
+                });
+        }
+    }
+
 public:
+    NumaJobQueueGroup() : m_steals_remote(0)
+    { }
+
     //! Register a JobQueue in the group, this function is NOT THREAD-SAFE.
     void add_jobqueue(jobqueue_type* jq)
     {
@@ -357,6 +668,8 @@ public:
             //abort();
         }
 
+        calc_victims(realNumaNodes);
+
         int runThreads = std::min(omp_get_max_threads(), numJobQueues);
 
         omp_set_nested(true); // enable nested parallel regions
@@ -380,17 +693,27 @@ public:
 
             LOG1 << "JobQueue[" << k << "] took : " << timer.elapsed() << " s";
         }
+
+        size_t steals_sibling = 0, steals_node = 0;
+        for (size_t k = 0; k < m_queues.size(); ++k) {
+            steals_sibling += m_queues[k]->steals_sibling();
+            steals_node += m_queues[k]->steals_node();
+        }
+
+        g_stats >> "steals_sibling" << steals_sibling
+            >> "steals_node" << steals_node
+            >> "steals_remote" << m_steals_remote
+            >> "steal_remote_minsize" << g_steal_remote_minsize;
     }
 
     //! called by JobQueue's when they want to assist other queues.
     bool assist(unsigned qid)
     {
-        unsigned id = qid;
+        const std::vector<unsigned>& victims = m_victims[qid];
 
-        for (unsigned i = 1; i < m_queues.size(); ++i)
+        for (size_t i = 0; i < victims.size(); ++i)
         {
-            // go through queues round-robin starting at own
-            if (++id >= m_queues.size()) id = 0;
+            unsigned id = victims[i];
 
             if (m_queues[id]->try_run())
             {
@@ -401,6 +724,27 @@ public:
 
         return false;
     }
+
+    //! called by idle threads of JobQueue qid to run a big job of a busy
+    //! JobQueue of another NUMA node, nearest first.
+    bool steal_remote(unsigned qid)
+    {
+        const std::vector<unsigned>& victims = m_victims[qid];
+
+        for (size_t i = 0; i < victims.size(); ++i)
+        {
+            unsigned id = victims[i];
+
+            if (m_queues[id]->try_run_remote(g_steal_remote_minsize))
+            {
+                LOGC(debug_queue) << "JobQueue[" << qid << "] stole from " << id;
+                ++m_steals_remote;
+                return true;
+            }
+        }
+
+        return false;
+    }
 };
 
 //! Define "standard" JobQueue, which passes a reference to itself as cookie
@@ -23,6 +23,12 @@
 #ifndef PSS_SRC_TOOLS_LOCKFREE_HEADER
 #define PSS_SRC_TOOLS_LOCKFREE_HEADER
 
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+
+#include "threadpool.hpp"
+
 namespace lockfree {
 
 template <unsigned MaxThreads>
@@ -77,7 +83,7 @@ public:
     //! lazy adding of a delta
     lazy_counter & add(ssize_t delta)
     {
-        return add(delta, omp_get_thread_num());
+        return add(delta, ThreadPool::thread_num());
     }
 
     //! update the lazy couter
@@ -113,6 +119,156 @@ public:
     }
 };
 
+/*!
+ * Chase-Lev work-stealing deque of (pointer) items. The owner thread pushes
+ * and pops at the bottom (LIFO), while other threads steal from the top
+ * (FIFO). The memory orderings follow "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" by Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+ *
+ * The circular array grows on demand. Old arrays are kept until the deque is
+ * destroyed, since concurrent thieves may still read from them.
+ */
+template <typename Type>
+class chase_lev_deque
+{
+protected:
+    //! circular array of items, size is always a power of two
+    struct array
+    {
+        size_t size;
+        std::atomic<Type>* items;
+
+        explicit array(size_t _size)
+            : size(_size), items(new std::atomic<Type>[_size])
+        { }
+
+        ~array()
+        {
+            delete[] items;
+        }
+
+        Type get(ssize_t i) const
+        {
+            return items[i & (size - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(ssize_t i, Type x)
+        {
+            items[i & (size - 1)].store(x, std::memory_order_relaxed);
+        }
+    };
+
+    //! index of top item, modified by thieves
+    std::atomic<ssize_t> m_top;
+
+    //! spacing to put top and bottom onto different cache-lines
+    char m_filled[64 - sizeof(ssize_t)];
+
+    //! index beyond bottom item, modified only by the owner
+    std::atomic<ssize_t> m_bottom;
+
+    //! current circular array
+    std::atomic<array*> m_array;
+
+    //! previous arrays, which may still be read by concurrent thieves
+    std::vector<array*> m_garbage;
+
+    //! double size of circular array, called only by the owner
+    array * grow(array* a, ssize_t bottom, ssize_t top)
+    {
+        array* na = new array(2 * a->size);
+        for (ssize_t i = top; i != bottom; ++i)
+            na->put(i, a->get(i));
+
+        m_garbage.push_back(a);
+        m_array.store(na, std::memory_order_release);
+        return na;
+    }
+
+public:
+    explicit chase_lev_deque(size_t initial_size = 1024)
+        : m_top(0), m_bottom(0),
+          m_array(new array(initial_size))
+    { }
+
+    ~chase_lev_deque()
+    {
+        delete m_array.load();
+        for (size_t i = 0; i < m_garbage.size(); ++i)
+            delete m_garbage[i];
+    }
+
+    //! push an item onto the bottom, must be called by the owner
+    void push(Type x)
+    {
+        ssize_t b = m_bottom.load(std::memory_order_relaxed);
+        ssize_t t = m_top.load(std::memory_order_acquire);
+        array* a = m_array.load(std::memory_order_relaxed);
+
+        if (b - t > static_cast<ssize_t>(a->size) - 1)
+            a = grow(a, b, t);
+
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    //! pop an item from the bottom, must be called by the owner
+    bool pop(Type& x)
+    {
+        ssize_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        array* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ssize_t t = m_top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // deque was empty
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        x = a->get(b);
+        if (t != b) return true;
+
+        // last item: race against thieves
+        bool won = m_top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    //! steal an item from the top, may be called by any thread
+    bool steal(Type& x)
+    {
+        ssize_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ssize_t b = m_bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return false;
+
+        array* a = m_array.load(std::memory_order_acquire);
+        x = a->get(t);
+
+        return m_top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    //! estimated number of items, only exact if no concurrent changes occur
+    size_t size() const
+    {
+        ssize_t s = m_bottom.load(std::memory_order_relaxed)
+                    - m_top.load(std::memory_order_relaxed);
+        return s < 0 ? 0 : s;
+    }
+
+    //! check if deque is empty, same restrictions as size()
+    bool empty() const
+    {
+        return size() == 0;
+    }
+};
+
 } // namespace lockfree
 
 #endif // !PSS_SRC_TOOLS_LOCKFREE_HEADER
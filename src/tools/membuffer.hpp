@@ -25,6 +25,10 @@
 #ifndef PSS_SRC_TOOLS_MEMBUFFER_HEADER
 #define PSS_SRC_TOOLS_MEMBUFFER_HEADER
 
+#include "hugepage.hpp"
+
+//! Array of trivial items, on huge pages with -M mmap_huge.
+
 template <typename Type>
 class membuffer
 {
@@ -47,14 +51,14 @@ public:
 
     /// Allocate memory buffer
     inline membuffer(size_t size)
-        : m_ptr(new Type[size]),
+        : m_ptr(hugepage::allocate_array<Type>(size)),
           m_size(size)
     { }
 
     /// Deallocate memory buffer
     inline ~membuffer()
     {
-        delete[] m_ptr;
+        hugepage::deallocate(m_ptr);
     }
 
     /// Accessor to elements
@@ -76,8 +80,8 @@ public:
 
     inline void copy(const membuffer& b)
     {
-        if (m_ptr) delete[] m_ptr;
-        m_ptr = new Type[b.m_size];
+        hugepage::deallocate(m_ptr);
+        m_ptr = hugepage::allocate_array<Type>(b.m_size);
         m_size = b.m_size;
         memcpy(m_ptr, b.m_ptr, b.m_size * sizeof(Type));
     }
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * src/tools/perf_counters.hpp
+ *
+ * Hardware performance counters via perf_event_open() for all threads of the
+ * process, used by psstest --perf around each contestant run.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_TOOLS_PERF_COUNTERS_HEADER
+#define PSS_SRC_TOOLS_PERF_COUNTERS_HEADER
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "stats_writer.hpp"
+
+/*!
+ * Set of hardware counters (cycles, instructions, LLC misses, dTLB misses and
+ * branch misses) counting all threads of the process. perf_event_open() with
+ * inherit only follows threads created after opening, while the OpenMP team
+ * and thread pool workers already exist, hence the counters are opened on
+ * each thread in /proc/self/task and summed up.
+ */
+class PerfCounters
+{
+public:
+    //! number of events counted
+    static const size_t num_events = 5;
+
+protected:
+    //! file descriptors: m_fds[thread * num_events + event]
+    std::vector<int> m_fds;
+
+    //! scaled event counts after stop()
+    uint64_t m_value[num_events];
+
+    //! whether the event could be opened
+    bool m_supported[num_events];
+
+    //! description of an event
+    struct Event
+    {
+        const char* name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    //! return description of event i
+    static const Event& event(size_t i)
+    {
+        static const Event events[num_events] = {
+            { "perf_cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { "perf_instructions",
+              PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { "perf_llc_misses", PERF_TYPE_HW_CACHE,
+              PERF_COUNT_HW_CACHE_LL |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "perf_dtlb_misses", PERF_TYPE_HW_CACHE,
+              PERF_COUNT_HW_CACHE_DTLB |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "perf_branch_misses",
+              PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        return events[i];
+    }
+
+    //! open event i on thread tid, counting also threads created later.
+    static int open_event(size_t i, pid_t tid)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event(i).type;
+        attr.config = event(i).config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0);
+    }
+
+    //! read value of counter fd, scaled up if it was multiplexed.
+    static uint64_t read_event(int fd)
+    {
+        uint64_t v[3]; // value, time enabled, time running
+        if (read(fd, v, sizeof(v)) != sizeof(v)) return 0;
+        if (v[2] == 0) return 0;
+        if (v[2] < v[1])
+            return static_cast<uint64_t>(
+                static_cast<double>(v[0]) * v[1] / v[2]);
+        return v[0];
+    }
+
+    //! apply ioctl request to all counters
+    void ioctl_all(unsigned long request)
+    {
+        for (size_t i = 0; i < m_fds.size(); ++i) {
+            if (m_fds[i] >= 0) ioctl(m_fds[i], request, 0);
+        }
+    }
+
+public:
+    PerfCounters()
+    {
+        memset(m_value, 0, sizeof(m_value));
+        std::fill(m_supported, m_supported + num_events, false);
+    }
+
+    ~PerfCounters()
+    {
+        close();
+    }
+
+    //! open counters on all current threads of the process. Events the CPU
+    //! does not support are skipped, returns false and prints a message if no
+    //! event could be opened.
+    bool open()
+    {
+        close();
+
+        DIR* dir = opendir("/proc/self/task");
+        if (!dir) {
+            std::cout << "PerfCounters: could not open /proc/self/task: "
+                      << strerror(errno) << std::endl;
+            return false;
+        }
+
+        std::fill(m_supported, m_supported + num_events, true);
+
+        while (struct dirent* de = readdir(dir))
+        {
+            if (de->d_name[0] == '.') continue;
+            pid_t tid = atoi(de->d_name);
+
+            for (size_t i = 0; i < num_events; ++i)
+            {
+                int fd = m_supported[i] ? open_event(i, tid) : -1;
+                if (fd < 0 && m_supported[i] && errno != ESRCH) {
+                    std::cout << "PerfCounters: perf_event_open("
+                              << event(i).name << ") failed: "
+                              << strerror(errno) << std::endl;
+                    m_supported[i] = false;
+                }
+                m_fds.push_back(fd);
+            }
+        }
+
+        closedir(dir);
+
+        if (std::count(m_supported, m_supported + num_events, true) == 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    //! close all counters
+    void close()
+    {
+        for (size_t i = 0; i < m_fds.size(); ++i) {
+            if (m_fds[i] >= 0) ::close(m_fds[i]);
+        }
+        m_fds.clear();
+    }
+
+    //! reset and start counting
+    void start()
+    {
+        ioctl_all(PERF_EVENT_IOC_RESET);
+        ioctl_all(PERF_EVENT_IOC_ENABLE);
+    }
+
+    //! stop counting and sum up counters of all threads
+    void stop()
+    {
+        ioctl_all(PERF_EVENT_IOC_DISABLE);
+
+        memset(m_value, 0, sizeof(m_value));
+        for (size_t i = 0; i < m_fds.size(); ++i) {
+            if (m_fds[i] >= 0) m_value[i % num_events] += read_event(m_fds[i]);
+        }
+    }
+
+    //! return summed value of event i
+    uint64_t value(size_t i) const
+    {
+        return m_value[i];
+    }
+
+    //! output values of supported counters divided by repeats as perf_* keys
+    void put_stats(stats_writer& s, size_t repeats = 1) const
+    {
+        for (size_t i = 0; i < num_events; ++i) {
+            if (m_supported[i]) s >> event(i).name << m_value[i] / repeats;
+        }
+    }
+};
+
+#endif // !PSS_SRC_TOOLS_PERF_COUNTERS_HEADER
+
+/******************************************************************************/
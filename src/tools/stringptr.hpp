@@ -37,6 +37,7 @@
 #ifndef PSS_SRC_TOOLS_STRINGPTR_HEADER
 #define PSS_SRC_TOOLS_STRINGPTR_HEADER
 
+#include <algorithm>
 #include <cassert>
 #include <stdint.h>
 #include <numa.h>
@@ -716,7 +717,8 @@ public:
     {
         assert(i > 0);
         assert(i < size());
-        assert(v == calc_lcp(active(), this->out(i - 1), this->out(i)));
+        assert(active().clamp_lcp(this->out(i - 1), this->out(i), v) ==
+               calc_lcp(active(), this->out(i - 1), this->out(i)));
 
         lcp(i) = v;
     }
@@ -971,6 +973,76 @@ public:
 typedef StringShadowLcpCacheOutPtr<parallel_string_sorting::UCharStringSet>
     UCharStringShadowLcpCacheOutPtr;
 
+/******************************************************************************/
+
+/*!
+ * Finish a bucket of strings whose keys are equal and end with a zero
+ * character, after copy_back(). All strings share a common prefix of depth
+ * characters. For zero-terminated StringSets they are then equal, and only
+ * their LCPs are filled in. The strings of a binary_safe StringSet may contain
+ * zero characters or be of different length, they are stably sorted by
+ * comparison from depth on and their LCPs and cached characters calculated.
+ */
+template <typename StringPtr>
+static inline void finish_zero_bucket(StringPtr strptr, size_t depth)
+{
+    typedef typename StringPtr::StringSet StringSet;
+    typedef typename StringSet::String String;
+    typedef typename StringSet::CharIterator CharIterator;
+
+    if (!StringSet::binary_safe) {
+        strptr.fill_lcp(depth);
+        return;
+    }
+
+    const StringSet& ss = strptr.output();
+
+    std::stable_sort(ss.begin(), ss.end(),
+                     [&ss, depth](const String& a, const String& b) {
+                         return ss.is_less_at(a, b, depth);
+                     });
+
+    if (!StringPtr::with_lcp) return;
+
+    for (size_t i = 1; i < ss.size(); ++i)
+    {
+        const String& a = ss.at(i - 1), & b = ss.at(i);
+        CharIterator ai = ss.get_chars(a, depth), bi = ss.get_chars(b, depth);
+
+        size_t h = depth;
+        while (ss.is_equal(a, ai, b, bi))
+            ++ai, ++bi, ++h;
+
+        strptr.set_lcp(i, h);
+        strptr.set_cache(i, ss.get_char(b, h));
+    }
+}
+
+/*!
+ * Clamp the LCPs of a sorted binary_safe StringSet to the string lengths,
+ * where they were calculated from keys padded with zeros, and recalculate the
+ * cached characters of clamped LCPs.
+ */
+template <typename StringPtr>
+static inline void clamp_padded_lcp(const StringPtr& strptr)
+{
+    typedef typename StringPtr::StringSet StringSet;
+
+    if (!StringSet::binary_safe || !StringPtr::with_lcp) return;
+
+    const StringSet& ss = strptr.output();
+
+#pragma omp parallel for
+    for (size_t i = 1; i < ss.size(); ++i)
+    {
+        size_t h = ss.clamp_lcp(ss.at(i - 1), ss.at(i), strptr.lcp(i));
+        if (h == strptr.lcp(i)) continue;
+
+        strptr.lcp(i) = h;
+        strptr.set_cache(i, ss.get_char(ss.at(i), h));
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 //! verify LCP array against sorted string array by scanning LCPs
@@ -1,8 +1,8 @@
 /*******************************************************************************
  * src/tools/stringset.hpp
  *
- * Implementations of StringSet concept: UCharStringSet, VectorStringSet,
- * StringSuffixSet.
+ * Implementations of StringSet concept: UCharStringSet, UCharLengthStringSet,
+ * VectorStringSet, StringSuffixSet.
  *
  * Additionally: LcpStringPtr encapsulates string and lcp arrays, which may be
  * interleaved or separate.
@@ -36,13 +36,17 @@
 #ifndef PSS_SRC_TOOLS_STRINGSET_HEADER
 #define PSS_SRC_TOOLS_STRINGSET_HEADER
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdint.h>
 #include <vector>
 #include <memory>
 
 #include <tlx/logger.hpp>
 
+#include "hugepage.hpp"
+
 namespace parallel_string_sorting {
 
 typedef uintptr_t lcp_t;
@@ -93,6 +97,11 @@ template <typename StringSet, typename Traits>
 class StringSetBase
 {
 public:
+    //! true if strings may contain zero characters, which then do not end the
+    //! string. The sorters cannot stop at a zero character in a key, they
+    //! finish such buckets by comparison, see finish_zero_bucket().
+    static const bool binary_safe = false;
+
     //! index-based array access (readable and writable) to String objects.
     typename Traits::String & at(size_t i) const
     {
@@ -135,6 +144,30 @@ public:
                (!ss.is_end(a, ai) && !ss.is_end(b, bi) && *ai <= *bi);
     }
 
+    //! check if string a is less than string b, comparing from depth on.
+    //! Unlike is_less() this is a strict weak ordering, e.g. for std::sort.
+    bool is_less_at(const typename Traits::String& a,
+                    const typename Traits::String& b, size_t depth) const
+    {
+        const StringSet& ss = *static_cast<const StringSet*>(this);
+
+        typename Traits::CharIterator ai = ss.get_chars(a, depth);
+        typename Traits::CharIterator bi = ss.get_chars(b, depth);
+
+        while (ss.is_equal(a, ai, b, bi))
+            ++ai, ++bi;
+
+        return !ss.is_end(b, bi) && (ss.is_end(a, ai) || *ai < *bi);
+    }
+
+    //! Return the LCP of strings a and b given an LCP calculated from keys
+    //! padded with zeros. Only binary_safe sets have to clamp it.
+    size_t clamp_lcp(const typename Traits::String&,
+                     const typename Traits::String&, size_t lcp) const
+    {
+        return lcp;
+    }
+
     //! \}
 
     //! \name Character Extractors
@@ -281,7 +314,7 @@ public:
         while (ss.is_equal(s1, c1, s2, c2))
             ++c1, ++c2;
 
-        if (!ss.is_leq(s1, c2, s2, c2))
+        if (!ss.is_leq(s1, c1, s2, c2))
             return false;
 
         return true;
@@ -446,11 +479,11 @@ public:
 
     //! Allocate a new temporary string container with n empty Strings
     static Container allocate(size_t n)
-    { return std::make_pair(new String[n], n); }
+    { return std::make_pair(hugepage::allocate_array<String>(n), n); }
 
     //! Deallocate a temporary string container
     static void deallocate(Container& c)
-    { delete[] c.first; c.first = NULL; }
+    { hugepage::deallocate(c.first); c.first = NULL; }
 
     //! \name CharIterator Comparisons
     //! \{
@@ -510,6 +543,363 @@ typedef GenericCharStringSet<unsigned char> UCharStringSet;
 
 /******************************************************************************/
 
+/*!
+ * String pointer with an attached satellite value, e.g. a record id. Both are
+ * stored interleaved in one array entry, such that the sorting algorithms move
+ * the payload together with the string and no second pass is needed to
+ * reorder records.
+ */
+template <typename CharType, typename PayloadType>
+struct StringPayload
+{
+    //! pointer to first character of zero-terminated string
+    CharType* str;
+    //! satellite value, moved along with the string
+    PayloadType payload;
+};
+
+/*!
+ * Traits class implementing StringSet concept for char* and unsigned char*
+ * strings carrying a payload.
+ */
+template <typename CharType, typename PayloadType>
+class GenericCharPayloadStringSetTraits
+{
+public:
+    //! exported alias for character type
+    typedef CharType Char;
+
+    //! exported alias for payload type
+    typedef PayloadType Payload;
+
+    //! String reference: pointer to first character and payload
+    typedef StringPayload<Char, Payload> String;
+
+    //! Iterator over string references: pointer over StringPayload structs
+    typedef String* Iterator;
+
+    //! iterator of characters in a string
+    typedef const Char* CharIterator;
+
+    //! exported alias for assumed string container
+    typedef std::pair<Iterator, size_t> Container;
+};
+
+/*!
+ * Class implementing StringSet concept for char* and unsigned char* strings
+ * which carry a payload.
+ */
+template <typename CharType, typename PayloadType = uint64_t>
+class GenericCharPayloadStringSet
+    : public GenericCharPayloadStringSetTraits<CharType, PayloadType>,
+      public StringSetBase<GenericCharPayloadStringSet<CharType, PayloadType>,
+                           GenericCharPayloadStringSetTraits<CharType, PayloadType> >
+{
+public:
+    typedef GenericCharPayloadStringSetTraits<CharType, PayloadType> Traits;
+
+    typedef typename Traits::Char Char;
+    typedef typename Traits::Payload Payload;
+    typedef typename Traits::String String;
+    typedef typename Traits::Iterator Iterator;
+    typedef typename Traits::CharIterator CharIterator;
+    typedef typename Traits::Container Container;
+
+    //! Construct from begin and end string pointers
+    GenericCharPayloadStringSet(Iterator begin, Iterator end)
+        : begin_(begin), end_(end)
+    { }
+
+    //! Construct from a string container
+    explicit GenericCharPayloadStringSet(const Container& c)
+        : begin_(c.first), end_(c.first + c.second)
+    { }
+
+    //! Return size of string array
+    size_t size() const { return end_ - begin_; }
+    //! Iterator representing first String position
+    Iterator begin() const { return begin_; }
+    //! Iterator representing beyond last String position
+    Iterator end() const { return end_; }
+
+    //! Iterator-based array access (readable and writable) to String objects.
+    String& operator [] (Iterator i) const
+    { return *i; }
+
+    //! Return CharIterator for referenced string, which belong to this set.
+    CharIterator get_chars(const String& s, size_t depth) const
+    { return s.str + depth; }
+
+    //! Returns true if CharIterator is at end of the given String
+    bool is_end(const String&, const CharIterator& i) const
+    { return (*i == 0); }
+
+    //! Return complete string (for debugging purposes)
+    std::string get_string(const String& s, size_t depth = 0) const
+    { return std::string(reinterpret_cast<const char*>(s.str) + depth); }
+
+    //! Subset this string set using iterator range.
+    GenericCharPayloadStringSet sub(Iterator begin, Iterator end) const
+    { return GenericCharPayloadStringSet(begin, end); }
+
+    //! Allocate a new temporary string container with n empty Strings
+    static Container allocate(size_t n)
+    { return std::make_pair(hugepage::allocate_array<String>(n), n); }
+
+    //! Deallocate a temporary string container
+    static void deallocate(Container& c)
+    { hugepage::deallocate(c.first); c.first = NULL; }
+
+    //! \name CharIterator Comparisons
+    //! \{
+
+    //! check equality of two strings a and b at char iterators ai and bi.
+    bool is_equal(const String&, const CharIterator& ai,
+                  const String&, const CharIterator& bi) const
+    {
+        return (*ai == *bi) && (*ai != 0);
+    }
+
+    //! check if string a is less or equal to string b at iterators ai and bi.
+    bool is_less(const String&, const CharIterator& ai,
+                 const String&, const CharIterator& bi) const
+    {
+        return (*ai < *bi);
+    }
+
+    //! check if string a is less or equal to string b at iterators ai and bi.
+    bool is_leq(const String&, const CharIterator& ai,
+                const String&, const CharIterator& bi) const
+    {
+        return (*ai <= *bi);
+    }
+
+    //! \}
+
+    //! \name Character Extractors
+    //! \{
+
+    //! Return up to 1 characters of string s at iterator i packed into a uint8
+    //! (only works correctly for 8-bit characters)
+    uint8_t get_char_uint8_simple(const String&, CharIterator i) const
+    {
+        return uint8_t(*i);
+    }
+
+    //! \}
+
+    void print() const
+    {
+        size_t i = 0;
+        for (Iterator pi = begin(); pi != end(); ++pi)
+        {
+            LOG1 << "[" << i++ << "] = " << pi->str
+                 << " payload " << pi->payload
+                 << " = " << get_string(*pi, 0);
+        }
+    }
+
+protected:
+    //! array of string pointers with payloads
+    Iterator begin_, end_;
+};
+
+typedef GenericCharPayloadStringSet<unsigned char> UCharPayloadStringSet;
+
+/******************************************************************************/
+
+/*!
+ * Binary string given by pointer and length, which may contain zero
+ * characters and needs no terminator.
+ */
+template <typename CharType>
+struct StringLength
+{
+    //! pointer to first character
+    const CharType* str;
+    //! number of characters
+    size_t length;
+};
+
+/*!
+ * Traits class implementing StringSet concept for length-prefixed binary
+ * strings of char or unsigned char.
+ */
+template <typename CharType>
+class GenericCharLengthStringSetTraits
+{
+public:
+    //! exported alias for character type
+    typedef CharType Char;
+
+    //! String reference: pointer to first character and length
+    typedef StringLength<Char> String;
+
+    //! Iterator over string references: pointer over StringLength structs
+    typedef String* Iterator;
+
+    //! iterator of characters in a string
+    typedef const Char* CharIterator;
+
+    //! exported alias for assumed string container
+    typedef std::pair<Iterator, size_t> Container;
+};
+
+/*!
+ * Class implementing StringSet concept for length-prefixed binary strings.
+ * Comparisons end at the known length instead of a zero terminator, and keys
+ * are loaded as whole words with the tail beyond the string masked off.
+ */
+template <typename CharType>
+class GenericCharLengthStringSet
+    : public GenericCharLengthStringSetTraits<CharType>,
+      public StringSetBase<GenericCharLengthStringSet<CharType>,
+                           GenericCharLengthStringSetTraits<CharType> >
+{
+public:
+    typedef GenericCharLengthStringSetTraits<CharType> Traits;
+
+    typedef typename Traits::Char Char;
+    typedef typename Traits::String String;
+    typedef typename Traits::Iterator Iterator;
+    typedef typename Traits::CharIterator CharIterator;
+    typedef typename Traits::Container Container;
+
+    //! strings may contain zero characters
+    static const bool binary_safe = true;
+
+    //! Construct from begin and end string pointers
+    GenericCharLengthStringSet(Iterator begin, Iterator end)
+        : begin_(begin), end_(end)
+    { }
+
+    //! Construct from a string container
+    explicit GenericCharLengthStringSet(const Container& c)
+        : begin_(c.first), end_(c.first + c.second)
+    { }
+
+    //! Return size of string array
+    size_t size() const { return end_ - begin_; }
+    //! Iterator representing first String position
+    Iterator begin() const { return begin_; }
+    //! Iterator representing beyond last String position
+    Iterator end() const { return end_; }
+
+    //! Iterator-based array access (readable and writable) to String objects.
+    String& operator [] (Iterator i) const
+    { return *i; }
+
+    //! Return CharIterator for referenced string, which belong to this set.
+    CharIterator get_chars(const String& s, size_t depth) const
+    { return s.str + depth; }
+
+    //! Returns true if CharIterator is at end of the given String
+    bool is_end(const String& s, const CharIterator& i) const
+    { return (i >= s.str + s.length); }
+
+    //! Return complete string (for debugging purposes)
+    std::string get_string(const String& s, size_t depth = 0) const
+    {
+        return std::string(reinterpret_cast<const char*>(s.str) + depth,
+                           reinterpret_cast<const char*>(s.str) + s.length);
+    }
+
+    //! Subset this string set using iterator range.
+    GenericCharLengthStringSet sub(Iterator begin, Iterator end) const
+    { return GenericCharLengthStringSet(begin, end); }
+
+    //! Allocate a new temporary string container with n empty Strings
+    static Container allocate(size_t n)
+    { return std::make_pair(hugepage::allocate_array<String>(n), n); }
+
+    //! Deallocate a temporary string container
+    static void deallocate(Container& c)
+    { hugepage::deallocate(c.first); c.first = NULL; }
+
+    //! Return the LCP of strings a and b given an LCP calculated from keys
+    //! padded with zeros, which may reach beyond the end of either string.
+    size_t clamp_lcp(const String& a, const String& b, size_t lcp) const
+    {
+        return std::min(lcp, std::min(a.length, b.length));
+    }
+
+    //! \name Character Extractors
+    //! \{
+
+    //! Return character at depth, or zero beyond the end
+    Char get_char(const String& s, size_t depth) const
+    {
+        return depth < s.length ? s.str[depth] : 0;
+    }
+
+    //! Return up to 4 characters of string s at depth packed into a uint32,
+    //! characters beyond the end are zero.
+    uint32_t get_uint32(const String& s, size_t depth) const
+    {
+        if (depth >= s.length) return 0;
+        return load_word<uint32_t>(s.str + depth, s.length - depth);
+    }
+
+    //! Return up to 8 characters of string s at depth packed into a uint64,
+    //! characters beyond the end are zero.
+    uint64_t get_uint64(const String& s, size_t depth) const
+    {
+        if (depth >= s.length) return 0;
+        return load_word<uint64_t>(s.str + depth, s.length - depth);
+    }
+
+    //! \}
+
+    void print() const
+    {
+        size_t i = 0;
+        for (Iterator pi = begin(); pi != end(); ++pi)
+        {
+            LOG1 << "[" << i++ << "] = " << (const void*)pi->str
+                 << " length " << pi->length
+                 << " = " << get_string(*pi, 0);
+        }
+    }
+
+protected:
+    //! array of string pointers with lengths
+    Iterator begin_, end_;
+
+    //! byte swap a word to big-endian order, such that integer comparison
+    //! orders the characters lexicographically.
+    static uint32_t bswap(uint32_t v) { return __builtin_bswap32(v); }
+    static uint64_t bswap(uint64_t v) { return __builtin_bswap64(v); }
+
+    //! Load a whole word of characters from p, of which only rest are part of
+    //! the string, and mask off the others. The word is loaded in one piece if
+    //! it does not cross a page boundary, hence it cannot fault.
+    template <typename Word>
+    static Word load_word(const Char* p, size_t rest)
+    {
+        Word v;
+        if (rest >= sizeof(Word)) {
+            memcpy(&v, p, sizeof(Word));
+            return bswap(v);
+        }
+        if ((reinterpret_cast<uintptr_t>(p) & 4095) <= 4096 - sizeof(Word)) {
+            memcpy(&v, p, sizeof(Word));
+            v = bswap(v);
+        }
+        else {
+            v = 0;
+            memcpy(&v, p, rest);
+            v = bswap(v);
+        }
+        // keep the rest most significant bytes
+        return v & ~(Word(-1) >> (8 * rest));
+    }
+};
+
+typedef GenericCharLengthStringSet<char> CharLengthStringSet;
+typedef GenericCharLengthStringSet<unsigned char> UCharLengthStringSet;
+
+/******************************************************************************/
+
 /*!
  * Class implementing StringSet concept for a std::vector containing std::string
  * objects.
@@ -760,6 +1150,14 @@ public:
     bool is_end(const String&, const CharIterator& i) const
     { return (i >= text_end_); }
 
+    //! Return character at depth, or zero beyond the end of the text, which
+    //! is not zero-terminated.
+    Char get_char(const String& s, size_t depth) const
+    {
+        CharIterator i = get_chars(s, depth);
+        return i < text_end_ ? *i : 0;
+    }
+
     //! Return complete string (for debugging purposes)
     std::string get_string(const String& s, size_t depth = 0) const
     {
@@ -773,11 +1171,12 @@ public:
 
     //! Allocate a new temporary string container with n empty Strings
     Container allocate(size_t n) const
-    { return std::make_tuple(text_, text_end_, new String[n], n); }
+    { return std::make_tuple(text_, text_end_,
+                             hugepage::allocate_array<String>(n), n); }
 
     //! Deallocate a temporary string container
     static void deallocate(Container& c)
-    { delete[] std::get<2>(c); }
+    { hugepage::deallocate(std::get<2>(c)); }
 
     //! Construct from a string container
     explicit UCharSuffixSet(Container& c)
@@ -805,6 +1204,191 @@ protected:
 
 /******************************************************************************/
 
+/*!
+ * Class implementing StringSet concept for zero-terminated strings stored in a
+ * text arena of less than 4 GiB, referenced by 32-bit offsets from the arena's
+ * base pointer. Sorting moves only half as many bytes as with char pointers.
+ */
+class UCharOffsetStringSetTraits
+{
+public:
+    //! exported alias for assumed text container
+    typedef const unsigned char* Text;
+
+    //! exported alias for character type
+    typedef unsigned char Char;
+
+    //! String reference: offset of the string in the text.
+    typedef uint32_t String;
+
+    //! Iterator over string references: pointer into offset array
+    typedef String* Iterator;
+
+    //! iterator of characters in a string
+    typedef const Char* CharIterator;
+
+    //! exported alias for assumed string container
+    typedef std::tuple<Text, Iterator, size_t> Container;
+};
+
+/*!
+ * Class implementing StringSet concept for zero-terminated strings referenced
+ * by 32-bit offsets into a text arena.
+ */
+class UCharOffsetStringSet
+    : public UCharOffsetStringSetTraits,
+      public StringSetBase<UCharOffsetStringSet, UCharOffsetStringSetTraits>
+{
+public:
+    //! Construct from text base and begin and end offset pointers
+    UCharOffsetStringSet(const Text& text,
+                         const Iterator& begin, const Iterator& end)
+        : text_(text), begin_(begin), end_(end)
+    { }
+
+    //! Return size of string array
+    size_t size() const { return end_ - begin_; }
+    //! Iterator representing first String position
+    Iterator begin() const { return begin_; }
+    //! Iterator representing beyond last String position
+    Iterator end() const { return end_; }
+
+    //! Array access (readable and writable) to String objects.
+    String& operator [] (const Iterator& i) const
+    { return *i; }
+
+    //! Return the text base pointer
+    Text text() const { return text_; }
+
+    //! Return CharIterator for referenced string, which belongs to this set.
+    CharIterator get_chars(const String& s, size_t depth) const
+    { return text_ + s + depth; }
+
+    //! Returns true if CharIterator is at end of the given String
+    bool is_end(const String&, const CharIterator& i) const
+    { return (*i == 0); }
+
+    //! Return complete string (for debugging purposes)
+    std::string get_string(const String& s, size_t depth = 0) const
+    { return std::string(reinterpret_cast<const char*>(text_ + s + depth)); }
+
+    //! Subset this string set using iterator range.
+    UCharOffsetStringSet sub(Iterator begin, Iterator end) const
+    { return UCharOffsetStringSet(text_, begin, end); }
+
+    //! Allocate a new temporary string container with n empty Strings
+    Container allocate(size_t n) const
+    { return std::make_tuple(text_, hugepage::allocate_array<String>(n), n); }
+
+    //! Deallocate a temporary string container
+    static void deallocate(Container& c)
+    { hugepage::deallocate(std::get<1>(c)); std::get<1>(c) = NULL; }
+
+    //! Construct from a string container
+    explicit UCharOffsetStringSet(Container& c)
+        : text_(std::get<0>(c)),
+          begin_(std::get<1>(c)), end_(std::get<1>(c) + std::get<2>(c))
+    { }
+
+    //! \name CharIterator Comparisons
+    //! \{
+
+    //! check equality of two strings a and b at char iterators ai and bi.
+    bool is_equal(const String&, const CharIterator& ai,
+                  const String&, const CharIterator& bi) const
+    {
+        return (*ai == *bi) && (*ai != 0);
+    }
+
+    //! check if string a is less or equal to string b at iterators ai and bi.
+    bool is_less(const String&, const CharIterator& ai,
+                 const String&, const CharIterator& bi) const
+    {
+        return (*ai < *bi);
+    }
+
+    //! check if string a is less or equal to string b at iterators ai and bi.
+    bool is_leq(const String&, const CharIterator& ai,
+                const String&, const CharIterator& bi) const
+    {
+        return (*ai <= *bi);
+    }
+
+    //! \}
+
+    //! \name Character Extractors
+    //! \{
+
+    //! Return up to 1 characters of string s at iterator i packed into a uint8
+    //! (only works correctly for 8-bit characters)
+    uint8_t get_char_uint8_simple(const String&, CharIterator i) const
+    {
+        return uint8_t(*i);
+    }
+
+    //! \}
+
+    void print() const
+    {
+        size_t i = 0;
+        for (Iterator pi = begin(); pi != end(); ++pi)
+        {
+            LOG1 << "[" << i++ << "] = " << *pi
+                 << " = " << get_string(*pi, 0);
+        }
+    }
+
+protected:
+    //! base pointer of the text arena
+    Text text_;
+
+    //! iterators inside the offset array.
+    Iterator begin_, end_;
+};
+
+/*!
+ * Sort the n zero-terminated strings of a pointer array via 32-bit offsets:
+ * convert the pointers into offsets from the smallest one, call sorter with a
+ * UCharOffsetStringSet, and convert the sorted offsets back. Returns false
+ * without sorting if the strings do not start within 4 GiB of each other.
+ */
+template <typename Sorter>
+static inline bool
+sort_as_offsets(unsigned char** strings, size_t n, const Sorter& sorter)
+{
+    typedef UCharOffsetStringSet::String String;
+
+    if (n == 0) return true;
+
+    uintptr_t lo = UINTPTR_MAX, hi = 0;
+#pragma omp parallel for reduction(min:lo) reduction(max:hi)
+    for (size_t i = 0; i < n; ++i) {
+        uintptr_t p = reinterpret_cast<uintptr_t>(strings[i]);
+        if (p < lo) lo = p;
+        if (p > hi) hi = p;
+    }
+
+    if (hi - lo > UINT32_MAX) return false;
+
+    unsigned char* base = reinterpret_cast<unsigned char*>(lo);
+    String* offsets = hugepage::allocate_array<String>(n);
+
+#pragma omp parallel for
+    for (size_t i = 0; i < n; ++i)
+        offsets[i] = String(strings[i] - base);
+
+    sorter(UCharOffsetStringSet(base, offsets, offsets + n));
+
+#pragma omp parallel for
+    for (size_t i = 0; i < n; ++i)
+        strings[i] = base + offsets[i];
+
+    hugepage::deallocate(offsets);
+    return true;
+}
+
+/******************************************************************************/
+
 /*!
  * Class implementing StringSet concept for suffix sorting indexes of a
  * std::string text object.
@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * src/tools/threadpool.hpp
+ *
+ * Persistent pool of pinned worker threads, which run parallel regions of the
+ * JobQueue instead of starting a new OpenMP team for each sort.
+ *
+ *******************************************************************************
+ * Copyright (C) 2017 Timo Bingmann <tb@panthema.net>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef PSS_SRC_TOOLS_THREADPOOL_HEADER
+#define PSS_SRC_TOOLS_THREADPOOL_HEADER
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*!
+ * Pool of long-lived worker threads. A call to run() executes a function on
+ * the first nthreads threads of the pool, where the calling thread takes the
+ * role of thread 0, and blocks until all threads are done. This is an
+ * alternative to "#pragma omp parallel" which keeps the same threads, pinned
+ * to the same cores, across all sorts of a process.
+ *
+ * Only one parallel region can run at a time: try_run() returns false if the
+ * pool is busy, e.g. when called from within a running region, and the caller
+ * should fall back to OpenMP.
+ */
+class ThreadPool
+{
+public:
+    //! type of function run on each thread: (thread id, number of threads)
+    typedef std::function<void(size_t, size_t)> job_type;
+
+protected:
+    //! worker threads, thread 0 is the caller of run()
+    std::vector<std::thread> m_threads;
+
+    //! mutex and condition to wake up workers and to wait for completion
+    std::mutex m_mutex;
+    std::condition_variable m_cv_work, m_cv_done;
+
+    //! generation counter of parallel regions, incremented by run()
+    size_t m_generation;
+
+    //! function of current region and its number of threads
+    const job_type* m_job;
+    size_t m_job_threads;
+
+    //! number of workers still running the current region
+    size_t m_working;
+
+    //! flag to terminate workers
+    bool m_terminate;
+
+    //! flag whether a region is currently running
+    std::atomic<bool> m_busy;
+
+    //! id of the calling thread in the currently running region, or -1
+    static int& tls_thread_id()
+    {
+        static thread_local int id = -1;
+        return id;
+    }
+
+    //! pin calling thread to the given cpu
+    static void pin_thread(size_t cpu)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu % CPU_SETSIZE, &cpuset);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+            std::cout << "ThreadPool: could not pin thread to cpu "
+                      << cpu << std::endl;
+        }
+    }
+
+    //! main loop of worker thread tid
+    void worker(size_t tid, bool pin)
+    {
+        if (pin) pin_thread(tid);
+
+        size_t generation = 0;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true)
+        {
+            m_cv_work.wait(lock, [&]() {
+                               return m_terminate || m_generation != generation;
+                           });
+
+            if (m_terminate) return;
+            generation = m_generation;
+
+            if (tid >= m_job_threads) continue;
+
+            const job_type* job = m_job;
+            size_t nthreads = m_job_threads;
+
+            lock.unlock();
+            tls_thread_id() = tid;
+            (*job)(tid, nthreads);
+            tls_thread_id() = -1;
+            lock.lock();
+
+            if (--m_working == 0)
+                m_cv_done.notify_one();
+        }
+    }
+
+public:
+    //! Create pool with num_threads threads (including the caller), and
+    //! possibly pin worker thread i to cpu i.
+    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency(),
+                        bool pin = true)
+        : m_generation(0), m_job(NULL), m_job_threads(0), m_working(0),
+          m_terminate(false), m_busy(false)
+    {
+        if (num_threads == 0) num_threads = 1;
+
+        for (size_t tid = 1; tid < num_threads; ++tid)
+            m_threads.emplace_back(&ThreadPool::worker, this, tid, pin);
+    }
+
+    //! Stop and join all worker threads.
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_terminate = true;
+        }
+        m_cv_work.notify_all();
+
+        for (size_t i = 0; i < m_threads.size(); ++i)
+            m_threads[i].join();
+    }
+
+    //! Number of threads in the pool, including the caller of run().
+    size_t size() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    //! Run job on nthreads threads (at most size()) and wait for all to
+    //! finish. Returns false without running anything if the pool is busy.
+    bool try_run(size_t nthreads, const job_type& job)
+    {
+        if (m_busy.exchange(true)) return false;
+
+        if (nthreads == 0 || nthreads > size()) nthreads = size();
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_job_threads = nthreads;
+            m_working = nthreads - 1;
+            ++m_generation;
+        }
+        m_cv_work.notify_all();
+
+        // calling thread is thread 0
+        int prev_id = tls_thread_id();
+        tls_thread_id() = 0;
+        job(0, nthreads);
+        tls_thread_id() = prev_id;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_done.wait(lock, [&]() { return m_working == 0; });
+            m_job = NULL;
+        }
+
+        m_busy = false;
+        return true;
+    }
+
+    //! Pool bound to the calling thread, which its parallel regions use
+    //! instead of the process-wide g_thread_pool, or NULL.
+    static ThreadPool*& bound()
+    {
+        static thread_local ThreadPool* pool = NULL;
+        return pool;
+    }
+
+    //! Thread number of the caller: its id inside a running pool region, and
+    //! omp_get_thread_num() otherwise, also in OpenMP regions nested in jobs.
+    static unsigned thread_num()
+    {
+        int id = tls_thread_id();
+        return (id >= 0 && !omp_in_parallel()) ? id : omp_get_thread_num();
+    }
+
+    //! Run job on nthreads threads, or with OpenMP if the pool is busy.
+    void run(size_t nthreads, const job_type& job)
+    {
+        if (try_run(nthreads, job)) return;
+
+#pragma omp parallel num_threads(nthreads)
+        job(omp_get_thread_num(), omp_get_num_threads());
+    }
+};
+
+#endif // !PSS_SRC_TOOLS_THREADPOOL_HEADER
+
+/******************************************************************************/
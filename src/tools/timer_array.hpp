@@ -34,6 +34,8 @@
 
 #include <omp.h>
 
+#include "threadpool.hpp"
+
 /// Class to measure different parts of a funciton by switching between
 /// different aggregating timers. Immediately start with timer 0. Use enums in
 /// your code to give the timer numbers names.
@@ -229,7 +231,7 @@ public:
     //! switch to other timer tm for the current thread
     inline void change(unsigned int tm)
     {
-        return change(tm, omp_get_thread_num());
+        return change(tm, ThreadPool::thread_num());
     }
 
     //! return current timer of a thread
@@ -242,7 +244,7 @@ public:
     //! return current timer of the current thread
     inline unsigned int get_tmcurr()
     {
-        return get_tmcurr(omp_get_thread_num());
+        return get_tmcurr(ThreadPool::thread_num());
     }
 
     //! return amount of time spent in a timer
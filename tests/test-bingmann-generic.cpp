@@ -22,14 +22,20 @@
 
 #include <sequential/inssort.hpp>
 #include <sequential/bingmann-lcp_inssort.hpp>
+#include <sequential/bingmann-lcp_mergesort_binary.hpp>
 #include <sequential/bingmann-radix_sort.hpp>
 #include <sequential/bingmann-mkqs.hpp>
 #include <sequential/bingmann-sample_sort.hpp>
+#include <parallel/bingmann-parallel_auto.hpp>
+#include <parallel/bingmann-parallel_copy_burstsort.hpp>
+#include <parallel/bingmann-parallel_lcp_mergesort.hpp>
+#include <parallel/bingmann-parallel_lsd_radix_sort.hpp>
 #include <parallel/bingmann-parallel_mkqs.hpp>
 #include <parallel/bingmann-parallel_sample_sort.hpp>
 #include <parallel/bingmann-parallel_radix_sort.hpp>
 #include <tools/stringset.hpp>
 #include <tools/lcgrandom.hpp>
+#include <tools/threadpool.hpp>
 
 using namespace parallel_string_sorting;
 
@@ -84,6 +90,304 @@ void TestUCharString(const char* name,
     delete[] cstrings;
 }
 
+void TestUCharPayloadString(
+    const char* name,
+    void (* algo)(const UCharPayloadStringSet& ss, size_t depth),
+    const size_t nstrings, const size_t nchars,
+    const std::string& letters)
+{
+    typedef UCharPayloadStringSet::String String;
+
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " uchar* strings with payload"
+              << std::endl;
+
+    // array of string pointers with payloads, and original string pointers
+    String* cstrings = new String[nstrings];
+    unsigned char** origin = new unsigned char*[nstrings];
+
+    // generate random strings of length nchars, payload is original index
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        size_t slen = nchars + (rng() >> 8) % (nchars / 4);
+
+        origin[i] = new unsigned char[slen + 1];
+        fill_random(rng, letters, origin[i], origin[i] + slen);
+        origin[i][slen] = 0;
+
+        cstrings[i].str = origin[i];
+        cstrings[i].payload = i;
+    }
+
+    // run sorting algorithm
+    UCharPayloadStringSet ss(cstrings, cstrings + nstrings);
+    algo(ss, 0);
+    if (0) ss.print();
+
+    // check result
+    if (!ss.check_order()) {
+        std::cout << "Result is not sorted!" << std::endl;
+        abort();
+    }
+
+    // check that payloads moved with their strings
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        if (cstrings[i].payload >= nstrings ||
+            origin[cstrings[i].payload] != cstrings[i].str) {
+            std::cout << "Payload was not moved with its string!" << std::endl;
+            abort();
+        }
+    }
+
+    // free memory.
+    for (size_t i = 0; i < nstrings; ++i)
+        delete[] origin[i];
+
+    delete[] origin;
+    delete[] cstrings;
+}
+
+void TestStableOrder(
+    const char* name,
+    void (* algo)(const UCharPayloadStringSet& ss, size_t depth),
+    const size_t nstrings, const size_t nchars,
+    const std::string& letters)
+{
+    typedef UCharPayloadStringSet::String String;
+
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " uchar* strings with duplicates"
+              << std::endl;
+
+    // few different strings of length nchars, payload is original index
+    std::vector<String> cstrings(nstrings);
+    std::vector<unsigned char> text(nstrings * (nchars + 1));
+
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        unsigned char* str = text.data() + i * (nchars + 1);
+        fill_random(rng, letters, str, str + nchars);
+        str[nchars] = 0;
+
+        cstrings[i].str = str;
+        cstrings[i].payload = i;
+    }
+
+    // run sorting algorithm
+    UCharPayloadStringSet ss(cstrings.data(), cstrings.data() + nstrings);
+    algo(ss, 0);
+
+    // check result
+    if (!ss.check_order()) {
+        std::cout << "Result is not sorted!" << std::endl;
+        abort();
+    }
+
+    // equal strings must be in input order
+    for (size_t i = 1; i < nstrings; ++i)
+    {
+        if (strcmp(reinterpret_cast<const char*>(cstrings[i - 1].str),
+                   reinterpret_cast<const char*>(cstrings[i].str)) == 0 &&
+            cstrings[i - 1].payload > cstrings[i].payload) {
+            std::cout << "Equal strings are not in input order!" << std::endl;
+            abort();
+        }
+    }
+}
+
+void TestUnique(const char* name,
+                size_t (* algo)(const UCharStringSet& ss, size_t* counts,
+                                size_t depth),
+                const size_t nstrings, const size_t nchars,
+                const std::string& letters)
+{
+    typedef unsigned char* string;
+
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " uchar* strings with duplicates"
+              << std::endl;
+
+    // few different strings of length nchars
+    std::vector<string> cstrings(nstrings);
+    std::vector<unsigned char> text(nstrings * (nchars + 1));
+
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        cstrings[i] = text.data() + i * (nchars + 1);
+        fill_random(rng, letters, cstrings[i], cstrings[i] + nchars);
+        cstrings[i][nchars] = 0;
+    }
+
+    // sort a copy as reference
+    std::vector<string> sorted = cstrings;
+    bingmann_parallel_sample_sort::parallel_sample_sort_base(
+        UCharStringSet(sorted.data(), sorted.data() + nstrings), 0);
+
+    // run deduplicating algorithm
+    std::vector<size_t> counts(nstrings);
+    size_t m = algo(UCharStringSet(cstrings.data(), cstrings.data() + nstrings),
+                    counts.data(), 0);
+
+    // compare runs of equal strings with the distinct strings
+    size_t j = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        if (j + counts[i] > nstrings || counts[i] == 0) {
+            std::cout << "Counts of distinct strings are wrong!" << std::endl;
+            abort();
+        }
+        for (size_t k = j; k < j + counts[i]; ++k) {
+            if (strcmp(reinterpret_cast<const char*>(sorted[k]),
+                       reinterpret_cast<const char*>(cstrings[i])) != 0) {
+                std::cout << "Distinct strings are wrong!" << std::endl;
+                abort();
+            }
+        }
+        if (j + counts[i] < nstrings &&
+            strcmp(reinterpret_cast<const char*>(sorted[j + counts[i]]),
+                   reinterpret_cast<const char*>(cstrings[i])) == 0) {
+            std::cout << "Equal strings were not collapsed!" << std::endl;
+            abort();
+        }
+        j += counts[i];
+    }
+    if (j != nstrings) {
+        std::cout << "Counts of distinct strings are wrong!" << std::endl;
+        abort();
+    }
+}
+
+void TestFixedLength(const char* name,
+                     void (* algo)(const UCharStringSet& ss, size_t depth),
+                     const size_t nstrings, const size_t nchars,
+                     const std::string& letters)
+{
+    typedef unsigned char* string;
+
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " uchar* strings of length " << nchars
+              << std::endl;
+
+    // strings of equal length nchars in one text
+    std::vector<string> cstrings(nstrings);
+    std::vector<unsigned char> text(nstrings * (nchars + 1));
+
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        cstrings[i] = text.data() + i * (nchars + 1);
+        fill_random(rng, letters, cstrings[i], cstrings[i] + nchars);
+        cstrings[i][nchars] = 0;
+    }
+
+    // run sorting algorithm
+    UCharStringSet ss(cstrings.data(), cstrings.data() + nstrings);
+    algo(ss, 0);
+
+    // check result
+    if (!ss.check_order()) {
+        std::cout << "Result is not sorted!" << std::endl;
+        abort();
+    }
+}
+
+void TestUCharOffsetString(
+    const char* name,
+    void (* algo)(const UCharOffsetStringSet& ss, size_t depth),
+    const size_t nstrings, const size_t nchars,
+    const std::string& letters)
+{
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " uint32_t offset strings" << std::endl;
+
+    // text arena of zero-terminated strings, and their offsets
+    std::vector<unsigned char> text;
+    std::vector<uint32_t> offsets(nstrings);
+
+    // generate random strings of length nchars
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        size_t slen = nchars + (rng() >> 8) % (nchars / 4);
+
+        offsets[i] = text.size();
+        text.resize(text.size() + slen + 1);
+        fill_random(rng, letters,
+                    text.begin() + offsets[i], text.begin() + offsets[i] + slen);
+        text[offsets[i] + slen] = 0;
+    }
+
+    // run sorting algorithm
+    UCharOffsetStringSet ss(
+        text.data(), offsets.data(), offsets.data() + offsets.size());
+    algo(ss, 0);
+    if (0) ss.print();
+
+    // check result
+    if (!ss.check_order()) {
+        std::cout << "Result is not sorted!" << std::endl;
+        abort();
+    }
+}
+
+void TestUCharLengthString(
+    const char* name,
+    void (* algo)(const UCharLengthStringSet& ss, size_t depth),
+    const size_t nstrings, const size_t nchars,
+    const std::string& letters, bool vary_length = false)
+{
+    typedef UCharLengthStringSet::String String;
+
+    LCGRandom rng(1234567);
+
+    std::cout << "Running " << name
+              << " on " << nstrings << " length-prefixed strings" << std::endl;
+
+    // text arena of strings without terminators, and their lengths
+    std::vector<unsigned char> text;
+    std::vector<size_t> offsets(nstrings), lengths(nstrings);
+
+    // generate random strings of length nchars, or of length up to nchars
+    for (size_t i = 0; i < nstrings; ++i)
+    {
+        size_t slen = vary_length
+                      ? (rng() >> 8) % (nchars + 1)
+                      : nchars + (rng() >> 8) % (nchars / 4);
+
+        offsets[i] = text.size();
+        lengths[i] = slen;
+        text.resize(text.size() + slen);
+        fill_random(rng, letters,
+                    text.begin() + offsets[i], text.begin() + offsets[i] + slen);
+    }
+
+    std::vector<String> cstrings(nstrings);
+    for (size_t i = 0; i < nstrings; ++i) {
+        cstrings[i].str = text.data() + offsets[i];
+        cstrings[i].length = lengths[i];
+    }
+
+    // run sorting algorithm
+    UCharLengthStringSet ss(cstrings.data(), cstrings.data() + nstrings);
+    algo(ss, 0);
+    if (0) ss.print();
+
+    // check result
+    if (!ss.check_order()) {
+        std::cout << "Result is not sorted!" << std::endl;
+        abort();
+    }
+}
+
 void TestVectorString(const char* name,
                       void (* algo)(const VectorStringSet& ss, size_t depth),
                       const size_t nstrings, const size_t nchars,
@@ -223,14 +527,24 @@ void TestStringSuffixString(
 static const char* letters_alnum
     = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 
+// small alphabet with many zero characters for binary strings
+static const std::string letters_binary("\0\0\1a", 4);
+
 // use macro because one cannot pass template functions as template parameters:
-#define run_tests(func)                                           \
-    TestUCharString(#func, func, nstrings, 16, letters_alnum);    \
-    TestVectorString(#func, func, nstrings, 16, letters_alnum);   \
-    TestUCharSuffixString(#func, func, nstrings, letters_alnum);  \
-    TestStringSuffixString(#func, func, nstrings, letters_alnum); \
+#define run_tests(func)                                               \
+    TestUCharString(#func, func, nstrings, 16, letters_alnum);        \
+    TestUCharPayloadString(#func, func, nstrings, 16, letters_alnum); \
+    TestUCharOffsetString(#func, func, nstrings, 16, letters_alnum);  \
+    TestUCharLengthString(#func, func, nstrings, 16, letters_alnum);  \
+    TestVectorString(#func, func, nstrings, 16, letters_alnum);       \
+    TestUCharSuffixString(#func, func, nstrings, letters_alnum);      \
+    TestStringSuffixString(#func, func, nstrings, letters_alnum);     \
     TestVectorPtrString(#func, func, nstrings, 16, letters_alnum);
 
+// binary strings containing zeros, only for binary-safe algorithms
+#define run_binary_tests(func) \
+    TestUCharLengthString(#func, func, nstrings, 16, letters_binary, true);
+
 void test_all(const size_t nstrings)
 {
     if (nstrings <= 1024) {
@@ -238,7 +552,11 @@ void test_all(const size_t nstrings)
         run_tests(bingmann::lcp_insertion_sort_verify);
         run_tests(bingmann::lcp_insertion_sort_pseudocode_verify);
         run_tests(bingmann::lcp_insertion_sort_cache_verify);
+        run_binary_tests(inssort::inssort_generic);
+        run_binary_tests(bingmann::lcp_insertion_sort_verify);
+        run_binary_tests(bingmann::lcp_insertion_sort_pseudocode_verify);
     }
+    run_tests(bingmann::lcp_mergesort_binary_verify);
     run_tests(bingmann::mkqs_generic);
     run_tests(bingmann::msd_CE0_generic);
     run_tests(bingmann::msd_CI2_generic);
@@ -246,10 +564,69 @@ void test_all(const size_t nstrings)
     run_tests(bingmann_parallel_radix_sort::parallel_radix_sort_16bit_generic);
     run_tests(bingmann_parallel_mkqs::bingmann_sequential_mkqs_cache8);
     run_tests(bingmann_parallel_mkqs::bingmann_parallel_mkqs);
+    run_tests(bingmann_parallel_auto::parallel_auto_generic);
     run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_base);
+    run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_base<
+                  bingmann_sample_sort::ClassifySimdTree>);
     run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_out_test);
     run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_lcp_verify);
     run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_out_lcp_verify);
+    run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_stable);
+    run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_stable_lcp_verify);
+    run_tests(bingmann_parallel_sample_sort::parallel_sample_sort_partial_test);
+
+    TestStableOrder("parallel_sample_sort_stable",
+                    bingmann_parallel_sample_sort::parallel_sample_sort_stable,
+                    nstrings, 12, "ab");
+    TestStableOrder("parallel_sample_sort_stable_lcp_verify",
+                    bingmann_parallel_sample_sort::parallel_sample_sort_stable_lcp_verify,
+                    nstrings, 12, "ab");
+
+    TestUnique("parallel_sample_sort_unique",
+               bingmann_parallel_sample_sort::parallel_sample_sort_unique,
+               nstrings, 12, "ab");
+    TestUnique("parallel_sample_sort_unique",
+               bingmann_parallel_sample_sort::parallel_sample_sort_unique,
+               nstrings, 4, letters_alnum);
+
+    // copy-burstsort only sorts uchar* strings
+    TestUCharString("parallel_copy_burstsort",
+                    bingmann_parallel_copy_burstsort::parallel_copy_burstsort,
+                    nstrings, 16, letters_alnum);
+    TestUCharString("parallel_copy_burstsort",
+                    bingmann_parallel_copy_burstsort::parallel_copy_burstsort,
+                    nstrings, 16, "ab");
+
+    TestUCharString("parallel_lcp_mergesort<8>",
+                    bingmann_parallel_lcp_mergesort::parallel_lcp_mergesort<8>,
+                    nstrings, 16, letters_alnum);
+    TestUCharString("parallel_lcp_mergesort<64>",
+                    bingmann_parallel_lcp_mergesort::parallel_lcp_mergesort<64>,
+                    nstrings, 16, "ab");
+
+    // strings of varying length fall back to pS5
+    run_tests(bingmann_parallel_lsd_radix_sort::parallel_lsd_radix_sort_8bit_generic);
+    TestFixedLength("parallel_lsd_radix_sort_8bit_generic",
+                    bingmann_parallel_lsd_radix_sort::parallel_lsd_radix_sort_8bit_generic,
+                    nstrings, 12, letters_alnum);
+    TestFixedLength("parallel_lsd_radix_sort_16bit_generic",
+                    bingmann_parallel_lsd_radix_sort::parallel_lsd_radix_sort_16bit_generic,
+                    nstrings, 11, letters_alnum);
+    TestFixedLength("parallel_lsd_radix_sort_16bit_generic",
+                    bingmann_parallel_lsd_radix_sort::parallel_lsd_radix_sort_16bit_generic,
+                    nstrings, 16, "ab");
+
+    run_binary_tests(bingmann::lcp_mergesort_binary_verify);
+    run_binary_tests(bingmann_parallel_radix_sort::parallel_radix_sort_8bit_generic);
+    run_binary_tests(bingmann_parallel_radix_sort::parallel_radix_sort_16bit_generic);
+    run_binary_tests(bingmann_parallel_mkqs::bingmann_sequential_mkqs_cache8);
+    run_binary_tests(bingmann_parallel_mkqs::bingmann_parallel_mkqs);
+    run_binary_tests(bingmann_parallel_auto::parallel_auto_generic);
+    run_binary_tests(bingmann_parallel_sample_sort::parallel_sample_sort_base);
+    run_binary_tests(bingmann_parallel_sample_sort::parallel_sample_sort_out_test);
+    run_binary_tests(bingmann_parallel_sample_sort::parallel_sample_sort_lcp_verify);
+    run_binary_tests(bingmann_parallel_sample_sort::parallel_sample_sort_out_lcp_verify);
+    run_binary_tests(bingmann_parallel_sample_sort::parallel_sample_sort_stable);
 }
 
 int main()
@@ -260,6 +637,19 @@ int main()
     test_all(1024 * 1024);
     test_all(16 * 1024 * 1024);
 
+    // run again with per-thread work-stealing deques in the JobQueue
+    gopt_work_stealing = true;
+    test_all(65550);
+    test_all(1024 * 1024);
+    gopt_work_stealing = false;
+
+    // run again on a persistent thread pool
+    g_thread_pool = new ThreadPool();
+    test_all(65550);
+    test_all(1024 * 1024);
+    delete g_thread_pool;
+    g_thread_pool = NULL;
+
     return 0;
 }
 
@@ -20,9 +20,13 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
 
+#include <pss.hpp>
 #include <sequential/bingmann-sample_sort.hpp>
+#include <sequential/bingmann-sample_sortKTS.hpp>
 #include <tools/stringset.hpp>
+#include <tools/stringptr.hpp>
 #include <tools/lcgrandom.hpp>
+#include <tlx/die.hpp>
 
 template <typename Iterator>
 void fill_random(LCGRandom& rng, const std::string& letters,
@@ -94,16 +98,265 @@ void test_all(const size_t nstrings)
 
     run_tests(bingmann_sample_sort::bingmann_sample_sortBTCE);
     run_tests(bingmann_sample_sort::bingmann_sample_sortBTCEA);
+
+    run_tests(bingmann_sample_sort::bingmann_sample_sortKTS);
+}
+
+/******************************************************************************/
+// SIMD Classifier Kernels
+
+template <size_t TreeBits>
+void test_simd_classifier(bingmann_sample_sort::SimdLevel level)
+{
+    using namespace bingmann_sample_sort;
+    typedef ClassifySimdTree<TreeBits> Classify;
+
+    std::cout << "Running ClassifySimdTree<" << TreeBits << "> with "
+              << simd_level_name(level) << std::endl;
+
+    LCGRandom rng(1234567);
+
+    // samples with many duplicates, small keys and maximum keys
+    const size_t samplesize = 2 * Classify::numsplitters;
+    std::vector<key_type> samples(samplesize);
+    for (size_t i = 0; i < samplesize; ++i) {
+        samples[i] = rng() % (samplesize / 2);
+        if (rng() % 8 == 0) samples[i] = key_type(-1) - rng() % 2;
+        if (rng() % 2 == 0) samples[i] <<= 40;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Classify* classifier = new Classify;
+    std::vector<unsigned char> splitter_lcp(Classify::numsplitters + 1);
+    classifier->build(samples.data(), samplesize, splitter_lcp.data(), level);
+
+    const key_type* splitter = classifier->splitter;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        key_type key = samples[rng() % samplesize] + rng() % 3 - 1;
+        if (i % 3 == 0) key = rng();
+
+        // reference: binary search in sorted splitter array
+        size_t r = std::lower_bound(
+            splitter, splitter + Classify::numsplitters, key) - splitter;
+        size_t b = 2 * r;
+        if (r < Classify::numsplitters && splitter[r] == key) b += 1;
+
+        die_unless(classifier->find_bkt(key) == b);
+    }
+
+    delete classifier;
+}
+
+void test_simd_classifiers()
+{
+    using namespace bingmann_sample_sort;
+
+    for (int level = SIMD_SCALAR; level <= simd_level_detect(); ++level)
+    {
+        test_simd_classifier<1>(SimdLevel(level));
+        test_simd_classifier<3>(SimdLevel(level));
+        test_simd_classifier<8>(SimdLevel(level));
+        test_simd_classifier<DefaultTreebits>(SimdLevel(level));
+        test_simd_classifier<13>(SimdLevel(level));
+    }
+}
+
+/******************************************************************************/
+// Library Interface
+
+static pss::executor* g_executor = NULL;
+
+void pss_sort_pS5(unsigned char** strings, size_t n)
+{
+    die_unless(pss::sort(strings, n));
+}
+
+void pss_sort_mkqs(unsigned char** strings, size_t n)
+{
+    pss::options opt;
+    opt.algo = pss::parallel_mkqs;
+    die_unless(pss::sort(strings, n, opt));
+}
+
+void pss_sort_pS5_executor(unsigned char** strings, size_t n)
+{
+    pss::options opt;
+    opt.exec = g_executor;
+    die_unless(pss::sort(strings, n, opt));
+}
+
+void pss_sort_mkqs_executor(unsigned char** strings, size_t n)
+{
+    pss::options opt;
+    opt.algo = pss::parallel_mkqs;
+    opt.exec = g_executor;
+    die_unless(pss::sort(strings, n, opt));
+}
+
+void pss_sort_pS5_lcp_cache(unsigned char** strings, size_t n)
+{
+    std::vector<pss::lcp_t> lcp(n);
+    std::vector<unsigned char> cache(n);
+
+    pss::options opt;
+    opt.lcp = lcp.data();
+    opt.charcache = cache.data();
+    opt.exec = g_executor;
+    die_unless(pss::sort(strings, n, opt));
+
+    die_unless(stringtools::verify_lcp_cache(
+                   strings, lcp.data(), cache.data(), n, 0));
+
+    // unsupported output is rejected
+    opt.algo = pss::parallel_mkqs;
+    die_unless(!pss::sort(strings, n, opt));
+}
+
+template <pss::algorithm algo>
+void pss_sort_payload(unsigned char** strings, size_t n)
+{
+    std::vector<pss::string_payload> spay(n);
+    for (size_t i = 0; i < n; ++i) {
+        spay[i].str = strings[i];
+        spay[i].payload = i;
+    }
+
+    std::vector<unsigned char*> origin(strings, strings + n);
+
+    pss::options opt;
+    opt.algo = algo;
+    opt.exec = g_executor;
+    die_unless(pss::sort(spay.data(), n, opt));
+
+    // payloads must have moved with their strings
+    for (size_t i = 0; i < n; ++i) {
+        die_unless(spay[i].payload < n);
+        die_unless(origin[spay[i].payload] == spay[i].str);
+        strings[i] = spay[i].str;
+    }
+}
+
+void pss_sort_stable(unsigned char** strings, size_t n)
+{
+    // sort each string four times, payload is the input index
+    std::vector<pss::string_payload> spay(4 * n);
+    for (size_t i = 0; i < spay.size(); ++i) {
+        spay[i].str = strings[i % n];
+        spay[i].payload = i;
+    }
+
+    pss::options opt;
+    opt.stable = true;
+    opt.exec = g_executor;
+    die_unless(pss::sort(spay.data(), spay.size(), opt));
+
+    // equal strings must keep their input order
+    for (size_t i = 1; i < spay.size(); ++i) {
+        if (spay[i - 1].str == spay[i].str)
+            die_unless(spay[i - 1].payload < spay[i].payload);
+    }
+
+    // unsupported stable order is rejected
+    opt.algo = pss::parallel_mkqs;
+    die_unless(!pss::sort(strings, n, opt));
+
+    die_unless(pss::sort(strings, n));
+}
+
+void pss_partial_sort(unsigned char** strings, size_t n)
+{
+    size_t k = n / 100 + 1;
+
+    pss::options opt;
+    opt.exec = g_executor;
+    die_unless(pss::partial_sort(strings, n, k, opt));
+
+    // sorting the rest separately must yield a completely sorted array
+    if (k < n) die_unless(pss::sort(strings + k, n - k, opt));
+
+    // unsupported LCP output is rejected
+    std::vector<pss::lcp_t> lcp(n);
+    opt.lcp = lcp.data();
+    die_unless(!pss::partial_sort(strings, n, k, opt));
+}
+
+void pss_sort_unique(unsigned char** strings, size_t n)
+{
+    // sort each string four times
+    std::vector<unsigned char*> dup(4 * n);
+    for (size_t i = 0; i < dup.size(); ++i)
+        dup[i] = strings[i % n];
+
+    std::vector<size_t> counts(dup.size());
+    std::vector<pss::lcp_t> lcp(dup.size());
+    std::vector<unsigned char> cache(dup.size());
+    size_t m;
+
+    pss::options opt;
+    opt.lcp = lcp.data();
+    opt.charcache = cache.data();
+    opt.exec = g_executor;
+    die_unless(pss::sort_unique(dup.data(), dup.size(), counts.data(), &m, opt));
+
+    // distinct strings are in strict order, and each appeared a multiple of
+    // four times.
+    size_t total = 0;
+    for (size_t i = 0; i < m; ++i) {
+        if (i != 0)
+            die_unless(strcmp(reinterpret_cast<char*>(dup[i - 1]),
+                              reinterpret_cast<char*>(dup[i])) < 0);
+        die_unless(counts[i] % 4 == 0);
+        total += counts[i];
+    }
+    die_unless(total == dup.size());
+
+    die_unless(stringtools::verify_lcp_cache(
+                   dup.data(), lcp.data(), cache.data(), m, 0));
+
+    // unsupported deduplication is rejected
+    opt.algo = pss::parallel_mkqs;
+    opt.lcp = NULL;
+    opt.charcache = NULL;
+    die_unless(!pss::sort_unique(strings, n, counts.data(), &m, opt));
+
+    die_unless(pss::sort(strings, n));
+}
+
+void test_pss(const size_t nstrings)
+{
+    run_tests(pss_sort_pS5);
+    run_tests(pss_sort_mkqs);
+    run_tests(pss_sort_pS5_executor);
+    run_tests(pss_sort_mkqs_executor);
+    run_tests(pss_sort_pS5_lcp_cache);
+    run_tests(pss_sort_payload<pss::pS5>);
+    run_tests(pss_sort_payload<pss::parallel_mkqs>);
+    run_tests(pss_sort_stable);
+    run_tests(pss_partial_sort);
+    run_tests(pss_sort_unique);
 }
 
 int main()
 {
+    test_simd_classifiers();
+
     test_all(16);
     test_all(256);
     test_all(65550);
     test_all(1024 * 1024);
     test_all(16 * 1024 * 1024);
 
+    g_executor = new pss::executor();
+
+    test_pss(16);
+    test_pss(256);
+    test_pss(65550);
+    test_pss(1024 * 1024);
+
+    delete g_executor;
+
     return 0;
 }
 